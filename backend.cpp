@@ -0,0 +1,294 @@
+#include "backend.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+std::unique_ptr<llvm::TargetMachine> create_target_machine(llvm::Module& module, int opt_level) {
+    // Once per process, even with several files compiling at once
+    static std::once_flag targets_initialized;
+    std::call_once(targets_initialized, []() {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmPrinters();
+    });
+
+    // Default to the host when no target was requested (e.g. --wasm sets its own)
+    llvm::Triple triple(module.getTargetTriple());
+    if (triple.getTriple().empty()) {
+        triple = llvm::Triple(llvm::sys::getDefaultTargetTriple());
+        module.setTargetTriple(triple);
+    }
+
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple.str(), error);
+    if (!target) {
+        std::cerr << "Warning: no backend for target " << triple.str() << ": " << error << std::endl;
+        return nullptr;
+    }
+
+    // Only tune for the host CPU when we are actually compiling for the host
+    std::string cpu = "generic";
+    if (triple.str() == llvm::sys::getDefaultTargetTriple()) {
+        cpu = llvm::sys::getHostCPUName().str();
+    }
+
+    llvm::CodeGenOptLevel codegen_level = llvm::CodeGenOptLevel::Default;
+    if (opt_level == 0) codegen_level = llvm::CodeGenOptLevel::None;
+    else if (opt_level == 1) codegen_level = llvm::CodeGenOptLevel::Less;
+    else if (opt_level >= 3) codegen_level = llvm::CodeGenOptLevel::Aggressive;
+
+    llvm::TargetOptions options;
+    llvm::TargetMachine* target_machine = target->createTargetMachine(
+        triple, cpu, "", options, llvm::Reloc::PIC_, std::nullopt, codegen_level);
+    if (!target_machine) {
+        std::cerr << "Warning: could not create target machine for " << triple.str() << std::endl;
+        return nullptr;
+    }
+
+    module.setDataLayout(target_machine->createDataLayout());
+    return std::unique_ptr<llvm::TargetMachine>(target_machine);
+}
+
+void optimize_module(llvm::Module& module, llvm::TargetMachine* target_machine, int opt_level, bool print_pipeline) {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+    llvm::PassInstrumentationCallbacks PIC;
+
+    // Match clang: vectorizers are only part of -O2 and up
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopVectorization = opt_level >= 2;
+    tuning.SLPVectorization = opt_level >= 2;
+
+    llvm::PassBuilder PB(target_machine, tuning, std::nullopt, &PIC);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::OptimizationLevel level = llvm::OptimizationLevel::O0;
+    if (opt_level == 1) level = llvm::OptimizationLevel::O1;
+    else if (opt_level == 2) level = llvm::OptimizationLevel::O2;
+    else if (opt_level >= 3) level = llvm::OptimizationLevel::O3;
+
+    llvm::ModulePassManager MPM = (opt_level == 0)
+        ? PB.buildO0DefaultPipeline(level)
+        : PB.buildPerModuleDefaultPipeline(level);
+
+    if (print_pipeline) {
+        llvm::errs() << "pipeline (-O" << opt_level << "): ";
+        MPM.printPipeline(llvm::errs(), [&PIC](llvm::StringRef class_name) {
+            llvm::StringRef pass_name = PIC.getPassNameForClassName(class_name);
+            return pass_name.empty() ? class_name : pass_name;
+        });
+        llvm::errs() << "\n";
+    }
+
+    MPM.run(module, MAM);
+}
+
+bool parse_emit_kind(const std::string& name, EmitKind& kind) {
+    if (name == "ll") kind = EmitKind::LLVM_IR;
+    else if (name == "bc") kind = EmitKind::Bitcode;
+    else if (name == "asm") kind = EmitKind::Assembly;
+    else if (name == "obj") kind = EmitKind::Object;
+    else if (name == "exe") kind = EmitKind::Executable;
+    else return false;
+    return true;
+}
+
+std::string emit_extension(EmitKind kind) {
+    switch (kind) {
+        case EmitKind::LLVM_IR: return ".ll";
+        case EmitKind::Bitcode: return ".bc";
+        case EmitKind::Assembly: return ".s";
+        case EmitKind::Object: return ".o";
+        case EmitKind::Executable: return "";
+    }
+    return "";
+}
+
+// Lower the module to native assembly or an object file with the target machine
+static bool emit_native(llvm::Module& module, llvm::TargetMachine* target_machine, llvm::CodeGenFileType file_type, const std::string& output_file) {
+    std::error_code EC;
+    llvm::raw_fd_ostream dest(output_file, EC, llvm::sys::fs::OF_None);
+    if (EC) {
+        std::cerr << "Could not open file: " << EC.message() << std::endl;
+        return false;
+    }
+
+    llvm::legacy::PassManager codegen;
+    if (target_machine->addPassesToEmitFile(codegen, dest, nullptr, file_type)) {
+        std::cerr << "Error: target " << module.getTargetTriple().str() << " cannot emit this file type" << std::endl;
+        return false;
+    }
+    codegen.run(module);
+    dest.flush();
+    return true;
+}
+
+bool emit_module(llvm::Module& module, llvm::TargetMachine* target_machine, EmitKind kind, const std::string& output_file,
+                 const std::vector<std::string>& link_inputs) {
+    if (kind == EmitKind::LLVM_IR || kind == EmitKind::Bitcode) {
+        std::error_code EC;
+        llvm::raw_fd_ostream dest(output_file, EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            std::cerr << "Could not open file: " << EC.message() << std::endl;
+            return false;
+        }
+        if (kind == EmitKind::LLVM_IR) {
+            module.print(dest, nullptr);
+        } else {
+            llvm::WriteBitcodeToFile(module, dest);
+        }
+        return true;
+    }
+
+    if (!target_machine) {
+        std::cerr << "Error: no native backend available, only --emit=ll and --emit=bc are possible" << std::endl;
+        return false;
+    }
+
+    if (kind == EmitKind::Assembly) {
+        return emit_native(module, target_machine, llvm::CodeGenFileType::AssemblyFile, output_file);
+    }
+    if (kind == EmitKind::Object) {
+        return emit_native(module, target_machine, llvm::CodeGenFileType::ObjectFile, output_file);
+    }
+
+    // Executable: object to a temporary file, then hand it to the system linker
+    llvm::SmallString<128> object_file;
+    if (std::error_code EC = llvm::sys::fs::createTemporaryFile("miaow", "o", object_file)) {
+        std::cerr << "Error: could not create temporary object file: " << EC.message() << std::endl;
+        return false;
+    }
+    std::vector<std::string> objects = {object_file.str().str()};
+    objects.insert(objects.end(), link_inputs.begin(), link_inputs.end());
+    bool ok = emit_native(module, target_machine, llvm::CodeGenFileType::ObjectFile, object_file.str().str())
+        && link_executable(objects, output_file, target_machine->getTargetTriple());
+    llvm::sys::fs::remove(object_file);
+    return ok;
+}
+
+// Run the system compiler driver on objects: a full link into an executable, or with relocatable,
+// a partial link (-r) into a single object
+static bool run_link_driver(const std::vector<std::string>& objects, const std::string& output_file,
+                            const llvm::Triple& triple, bool relocatable) {
+    std::string driver_name = triple.isWasm() ? "emcc" : "cc";
+    llvm::ErrorOr<std::string> driver = llvm::sys::findProgramByName(driver_name);
+    if (!driver) {
+        std::cerr << "Error: could not find linker driver '" << driver_name << "' in PATH" << std::endl;
+        return false;
+    }
+
+    std::vector<llvm::StringRef> args = {*driver};
+    if (relocatable) {
+        args.push_back("-r");
+    }
+    for (const std::string& object : objects) {
+        args.push_back(object);
+    }
+    args.push_back("-o");
+    args.push_back(output_file);
+
+    std::string error;
+    int status = llvm::sys::ExecuteAndWait(*driver, args, std::nullopt, {}, 0, 0, &error);
+    if (status != 0) {
+        std::cerr << "Error: linking " << output_file << " failed";
+        if (!error.empty()) std::cerr << ": " << error;
+        std::cerr << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Lower one partition to an object: it is parsed into a context of its own, so partitions are
+// optimized and lowered on separate threads without sharing any LLVM state
+static bool emit_partition(llvm::StringRef bitcode, int opt_level, bool print_pipeline, const std::string& object_file) {
+    llvm::LLVMContext context;
+    llvm::Expected<std::unique_ptr<llvm::Module>> part =
+        llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "partition"), context);
+    if (!part) {
+        std::cerr << "Error: could not read back module partition: " << llvm::toString(part.takeError()) << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<llvm::TargetMachine> target_machine = create_target_machine(**part, opt_level);
+    if (!target_machine) {
+        return false;
+    }
+    optimize_module(**part, target_machine.get(), opt_level, print_pipeline);
+    return emit_native(**part, target_machine.get(), llvm::CodeGenFileType::ObjectFile, object_file);
+}
+
+bool emit_module_split(llvm::Module& module, EmitKind kind, int opt_level, bool print_pipeline, unsigned threads,
+                       const std::string& output_file, const std::vector<std::string>& link_inputs) {
+    // Partitions share the module's context, so each is written out as bitcode before the threads start.
+    // Locals (string constants) stay local, in the partition of the funs using them, so that objects
+    // split this way can still be linked together.
+    std::vector<llvm::SmallString<0>> partitions;
+    llvm::SplitModule(module, threads, [&](std::unique_ptr<llvm::Module> part) {
+        llvm::raw_svector_ostream out(partitions.emplace_back());
+        llvm::WriteBitcodeToFile(*part, out);
+    }, /*PreserveLocals=*/true);
+
+    std::vector<std::string> objects;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        llvm::SmallString<128> object_file;
+        if (std::error_code EC = llvm::sys::fs::createTemporaryFile("miaow", "o", object_file)) {
+            std::cerr << "Error: could not create temporary object file: " << EC.message() << std::endl;
+            for (const std::string& object : objects) llvm::sys::fs::remove(object);
+            return false;
+        }
+        objects.push_back(object_file.str().str());
+    }
+
+    std::vector<char> emitted(partitions.size(), 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        // The pipeline is the same for every partition, so it is printed once
+        workers.emplace_back([&, i]() {
+            emitted[i] = emit_partition(partitions[i], opt_level, print_pipeline && i == 0, objects[i]);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    bool ok = std::all_of(emitted.begin(), emitted.end(), [](char e) { return e; });
+    llvm::Triple triple(module.getTargetTriple());
+    if (ok && kind == EmitKind::Executable) {
+        std::vector<std::string> inputs = objects;
+        inputs.insert(inputs.end(), link_inputs.begin(), link_inputs.end());
+        ok = link_executable(inputs, output_file, triple);
+    } else if (ok) {
+        // An object was asked for: join the partitions back into one with a relocatable link
+        ok = run_link_driver(objects, output_file, triple, true);
+    }
+    for (const std::string& object : objects) {
+        llvm::sys::fs::remove(object);
+    }
+    return ok;
+}
+
+bool link_executable(const std::vector<std::string>& objects, const std::string& output_file, const llvm::Triple& triple) {
+    return run_link_driver(objects, output_file, triple, false);
+}
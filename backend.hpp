@@ -0,0 +1,39 @@
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include "types.hpp"
+
+#include <llvm/Target/TargetMachine.h>
+
+// Output formats selectable with --emit=
+enum class EmitKind { LLVM_IR, Bitcode, Assembly, Object, Executable };
+
+// Create a TargetMachine for the module's target triple (host triple if unset)
+// and stamp the module with its data layout. Returns nullptr if the target is unavailable.
+std::unique_ptr<llvm::TargetMachine> create_target_machine(llvm::Module& module, int opt_level);
+
+// Run the standard new-PassManager pipeline for -O<opt_level> on the module.
+// With print_pipeline, the textual pipeline is written to stderr before it runs.
+void optimize_module(llvm::Module& module, llvm::TargetMachine* target_machine, int opt_level, bool print_pipeline);
+
+// Parse an --emit= value (ll, bc, asm, obj, exe). Returns false for unknown kinds.
+bool parse_emit_kind(const std::string& name, EmitKind& kind);
+
+// Conventional file extension for an output kind (empty for executables)
+std::string emit_extension(EmitKind kind);
+
+// Write the module to output_file in the requested format.
+// Executables are linked from a temporary object, plus link_inputs (e.g. --module objects), with the system compiler driver.
+bool emit_module(llvm::Module& module, llvm::TargetMachine* target_machine, EmitKind kind, const std::string& output_file,
+                 const std::vector<std::string>& link_inputs = {});
+
+// emit_module for --codegen-threads: split the module into up to `threads` partitions, then optimize
+// and lower each to an object on a thread of its own and link them (into one object for EmitKind::Object).
+// Only for Object and Executable. Funs in different partitions cannot be inlined into each other.
+bool emit_module_split(llvm::Module& module, EmitKind kind, int opt_level, bool print_pipeline, unsigned threads,
+                       const std::string& output_file, const std::vector<std::string>& link_inputs = {});
+
+// Link object files into an executable using the system compiler driver (cc, or emcc for wasm)
+bool link_executable(const std::vector<std::string>& objects, const std::string& output_file, const llvm::Triple& triple);
+
+#endif // BACKEND_HPP
@@ -0,0 +1,137 @@
+// Generates synthetic stress programs for the compiler throughput benchmark (make bench-compiler).
+//
+//   gen_program SHAPE N DIR
+//
+// writes DIR/SHAPE_N.miaow (and, for imports, the files it imports) and prints its path.
+// Every shape grows linearly with N, so a phase whose time grows faster than N is a regression.
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// N top-level defs, each reading the one before it
+static void gen_defs(std::ostream& out, long n) {
+    out << "{\n(def Int:v0 0)\n";
+    for (long i = 1; i < n; i++) {
+        out << "(def Int:v" << i << " (+ v" << i - 1 << " " << i % 7 << "))\n";
+    }
+    out << "(meow (->S v" << n - 1 << "))\n}\n";
+}
+
+// 16 defs whose values are blankets nested N deep
+static void gen_nesting(std::ostream& out, long n) {
+    out << "{\n";
+    for (int d = 0; d < 16; d++) {
+        out << "(def Int:n" << d << " ";
+        for (long i = 0; i < n; i++) out << (i % 2 ? "(* 1 " : "(+ 1 ");
+        out << d;
+        for (long i = 0; i < n; i++) out << ')';
+        out << ")\n(meow (->S n" << d << "))\n";
+    }
+    out << "}\n";
+}
+
+// N funs, each called once
+static void gen_funs(std::ostream& out, long n) {
+    out << "{\n";
+    for (long i = 0; i < n; i++) {
+        out << "(fun Int:(f" << i << " Int:a Int:b) {\n"
+            << "    (def Int:c (* a " << i % 13 << "))\n"
+            << "    (if (> c b) { (return (- c b)) })\n"
+            << "    (return (+ a b))\n"
+            << "})\n";
+    }
+    out << "(def Int:total 0)\n";
+    for (long i = 0; i < n; i++) {
+        out << "(= total (+ total (f" << i << " total " << i << ")))\n";
+    }
+    out << "(meow (->S total))\n}\n";
+}
+
+// N struct types with an adder each, all overloading +, and an overloaded call per type
+static void gen_overloads(std::ostream& out, long n) {
+    out << "{\n";
+    for (long i = 0; i < n; i++) {
+        out << "(struct S" << i << ":[Int:x])\n"
+            << "(fun Int:(add" << i << " S" << i << ":a S" << i << ":b) { (return (+ a>x b>x)) })\n";
+    }
+    out << "(overload + [";
+    for (long i = 0; i < n; i++) out << (i ? " add" : "add") << i;
+    out << "])\n(def Int:total 0)\n";
+    for (long i = 0; i < n; i++) {
+        out << "(def S" << i << ":s" << i << " S" << i << ":[" << i << "])\n"
+            << "(= total (+ total (+ s" << i << " s" << i << ")))\n";
+    }
+    out << "(meow (->S total))\n}\n";
+}
+
+// One struct of N fields, a literal of it and a read of every field
+static void gen_structs(std::ostream& out, long n) {
+    out << "{\n(struct Big:[";
+    for (long i = 0; i < n; i++) out << (i ? " Int:f" : "Int:f") << i;
+    out << "])\n(def Big:b Big:[";
+    for (long i = 0; i < n; i++) out << (i ? " " : "") << i;
+    out << "])\n(def Int:total 0)\n";
+    for (long i = 0; i < n; i++) {
+        out << "(= total (+ total b>f" << i << "))\n";
+    }
+    out << "(meow (->S total))\n}\n";
+}
+
+// A chain of N files, each importing the next and defining a fun; the program calls them all
+static bool gen_imports(std::ostream& out, long n, const std::string& dir) {
+    for (long i = 0; i < n; i++) {
+        std::string path = dir + "/chain" + std::to_string(i) + ".inf";
+        std::ofstream link(path);
+        if (!link) {
+            std::cerr << "Error: could not write " << path << "\n";
+            return false;
+        }
+        link << "{\n";
+        if (i + 1 < n) link << "!import " << dir << "/chain" << i + 1 << "\n";
+        link << "(fun Int:(c" << i << " Int:a) { (return (+ a " << i << ")) })\n}\n";
+    }
+    out << "{\n!import " << dir << "/chain0\n(def Int:total 0)\n";
+    for (long i = 0; i < n; i++) {
+        out << "(= total (c" << i << " total))\n";
+    }
+    out << "(meow (->S total))\n}\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::cerr << "usage: gen_program defs|nesting|funs|overloads|structs|imports N DIR\n";
+        return 1;
+    }
+    std::string shape = argv[1];
+    long n = strtol(argv[2], nullptr, 10);
+    std::string dir = argv[3];
+    if (n < 1) {
+        std::cerr << "Error: N must be a positive number, got '" << argv[2] << "'\n";
+        return 1;
+    }
+
+    std::string path = dir + "/" + shape + "_" + argv[2] + ".miaow";
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: could not write " << path << "\n";
+        return 1;
+    }
+
+    if (shape == "defs") gen_defs(out, n);
+    else if (shape == "nesting") gen_nesting(out, n);
+    else if (shape == "funs") gen_funs(out, n);
+    else if (shape == "overloads") gen_overloads(out, n);
+    else if (shape == "structs") gen_structs(out, n);
+    else if (shape == "imports") {
+        if (!gen_imports(out, n, dir)) return 1;
+    } else {
+        std::cerr << "Error: unknown shape " << shape << "\n";
+        return 1;
+    }
+
+    std::cout << path << "\n";
+    return 0;
+}
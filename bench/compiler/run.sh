@@ -0,0 +1,99 @@
+#!/bin/sh
+# Compiler throughput benchmark (make bench-compiler).
+#
+# Generates every stress shape at three sizes (N, 2N, 4N), compiles each RUNS times with
+# --time-report=json and keeps the fastest time of every phase. Prints a table and writes
+# bench/results/compiler.json. "growth" is a phase's time at 4N over its time at N: about 4 when
+# the phase is linear, 16 when it is quadratic. Growth above 8 is marked as superlinear.
+#
+# Environment: MIAOW (compiler, ./miaow), GEN (generator), RUNS (3), OUT (bench/results)
+set -e
+
+MIAOW=${MIAOW:-./miaow}
+GEN=${GEN:-bench/compiler/gen_program}
+RUNS=${RUNS:-3}
+OUT=${OUT:-bench/results}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+mkdir -p "$OUT"
+: > "$work/times.tsv"
+
+for spec in "defs 25000" "nesting 1000" "funs 1000" "overloads 250" "structs 1000" "imports 250"; do
+    set -- $spec
+    shape=$1
+    for size in $2 $(($2 * 2)) $(($2 * 4)); do
+        program=$("$GEN" "$shape" "$size" "$work")
+        run=0
+        while [ $run -lt "$RUNS" ]; do
+            if ! "$MIAOW" "$program" -o "$work/out.ll" --time-report=json 2> "$work/report.json" > /dev/null; then
+                echo "Error: $program failed to compile:" >&2
+                cat "$work/report.json" >&2
+                exit 1
+            fi
+            # One line per phase ({"name": "parse", "wall_ms": 1.234, ...}), then the totals
+            awk -v shape="$shape" -v size="$size" '
+                /"name":/ {
+                    match($0, /"name": "[^"]*"/); name = substr($0, RSTART + 9, RLENGTH - 10)
+                    match($0, /"wall_ms": [0-9.]*/); print shape "\t" size "\t" name "\t" substr($0, RSTART + 11, RLENGTH - 11)
+                }
+                /"peak_rss_kb":/ {
+                    match($0, /"peak_rss_kb": [0-9]*/); print shape "\t" size "\tpeak_rss_kb\t" substr($0, RSTART + 15, RLENGTH - 15)
+                }' "$work/report.json" >> "$work/times.tsv"
+            run=$((run + 1))
+        done
+    done
+done
+
+awk -F '\t' -v json="$OUT/compiler.json" -v runs="$RUNS" '
+    {
+        key = $1 SUBSEP $2 SUBSEP $3
+        if (!(key in best) || $4 + 0 < best[key] + 0) best[key] = $4
+        if (!($1 in seen_shape)) { seen_shape[$1] = 1; shapes[++nshapes] = $1 }
+        if (!(($1, $2) in seen_size)) { seen_size[$1, $2] = 1; sizes[$1, ++nsizes[$1]] = $2 }
+        if ($3 != "peak_rss_kb" && !(($1, $3) in seen_phase)) { seen_phase[$1, $3] = 1; phases[$1, ++nphases[$1]] = $3 }
+    }
+    END {
+        printf "{\"runs\": %d, \"results\": [", runs > json
+        first = 1
+        for (s = 1; s <= nshapes; s++) {
+            shape = shapes[s]
+            small = sizes[shape, 1]; large = sizes[shape, nsizes[shape]]
+            printf "\n%-10s %8s", shape, "size"
+            for (p = 1; p <= nphases[shape]; p++) printf " %10s", phases[shape, p]
+            printf " %12s\n", "peak rss KB"
+            for (z = 1; z <= nsizes[shape]; z++) {
+                size = sizes[shape, z]
+                printf "%-10s %8s", "", size
+                printf "%s\n  {\"shape\": \"%s\", \"size\": %s, \"wall_ms\": {", first ? "" : ",", shape, size > json
+                first = 0
+                for (p = 1; p <= nphases[shape]; p++) {
+                    phase = phases[shape, p]
+                    printf " %10.3f", best[shape, size, phase]
+                    printf "%s\"%s\": %s", (p > 1 ? ", " : ""), phase, best[shape, size, phase] > json
+                }
+                printf " %12s\n", best[shape, size, "peak_rss_kb"]
+                printf "}, \"peak_rss_kb\": %s}", best[shape, size, "peak_rss_kb"] > json
+            }
+
+            # Phases under a millisecond are mostly noise, so they are not judged
+            printf "%-10s %8s", "", "growth"
+            growth_json = growth_json (s > 1 ? "," : "") "\n  {\"shape\": \"" shape "\", \"growth\": {"
+            flagged = ""
+            for (p = 1; p <= nphases[shape]; p++) {
+                phase = phases[shape, p]
+                growth = best[shape, small, phase] > 0 ? best[shape, large, phase] / best[shape, small, phase] : 0
+                printf " %10.2f", growth
+                growth_json = growth_json sprintf("%s\"%s\": %.3f", p > 1 ? ", " : "", phase, growth)
+                if (growth > 8 && best[shape, large, phase] >= 1) flagged = flagged " " phase
+            }
+            printf "\n"
+            growth_json = growth_json "}, \"superlinear\": ["
+            n = split(flagged, names, " ")
+            for (i = 1; i <= n; i++) growth_json = growth_json sprintf("%s\"%s\"", i > 1 ? ", " : "", names[i])
+            growth_json = growth_json "]}"
+            if (flagged != "") printf "%-10s superlinear:%s\n", "", flagged
+        }
+        printf "\n], \"growth\": [%s\n]}\n", growth_json > json
+        printf "\nresults written to %s\n", json
+    }' "$work/times.tsv"
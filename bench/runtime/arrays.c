@@ -0,0 +1,46 @@
+// Array churn, as bench/runtime/arrays.miaow, on a growable int array
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int size;
+    int capacity;
+    int* data;
+} IntArray;
+
+static void append(IntArray* a, int value) {
+    if (a->size == a->capacity) {
+        a->capacity = a->capacity ? a->capacity * 2 : 1;
+        a->data = realloc(a->data, a->capacity * sizeof(int));
+    }
+    a->data[a->size++] = value;
+}
+
+static void insert(IntArray* a, int index, int value) {
+    append(a, 0);
+    memmove(a->data + index + 1, a->data + index, (a->size - 1 - index) * sizeof(int));
+    a->data[index] = value;
+}
+
+static void remove_at(IntArray* a, int index) {
+    memmove(a->data + index, a->data + index + 1, (a->size - index - 1) * sizeof(int));
+    a->size--;
+}
+
+int main(void) {
+    int checksum = 0;
+    for (int round = 0; round < 100; round++) {
+        IntArray xs = {0, 0, NULL};
+        append(&xs, 0);
+        for (int i = 1; i < 50000; i++) append(&xs, i * 7 % 1000);
+        for (int i = 0; i < 200; i++) {
+            insert(&xs, xs.size / 2, i);
+            remove_at(&xs, xs.size / 3);
+        }
+        while (xs.size > 0) checksum = (checksum * 31 + xs.data[--xs.size]) % 1000003;
+        free(xs.data);
+    }
+    printf("%d\n", checksum);
+    return 0;
+}
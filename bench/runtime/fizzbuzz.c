@@ -0,0 +1,12 @@
+// FizzBuzz up to 3 million, as bench/runtime/fizzbuzz.miaow
+#include <stdio.h>
+
+int main(void) {
+    for (int x = 1; x <= 3000000; x++) {
+        if (x % 15 == 0) puts("FizzBuzz");
+        else if (x % 3 == 0) puts("Fizz");
+        else if (x % 5 == 0) puts("Buzz");
+        else printf("%d\n", x);
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Runs a benchmark program once for the runtime benchmark (make bench-runtime).
+//
+//   measure OUTPUT PROGRAM [ARGS...]
+//
+// runs PROGRAM with its stdout sent to OUTPUT (e.g. /dev/null) and prints "wall_ms peak_rss_kb"
+// for it. Exits with the program's exit code.
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: measure OUTPUT PROGRAM [ARGS...]\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Error: fork");
+        return 1;
+    }
+    if (pid == 0) {
+        int out = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0 || dup2(out, STDOUT_FILENO) < 0) {
+            perror("Error: could not open output");
+            _exit(127);
+        }
+        execvp(argv[2], argv + 2);
+        perror("Error: could not run program");
+        _exit(127);
+    }
+
+    // wait4 reports the child's own peak RSS, not the whole process tree's
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("Error: wait4");
+        return 1;
+    }
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%.3f %ld\n", wall_ms, usage.ru_maxrss);
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "Error: %s killed by signal %d\n", argv[2], WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,34 @@
+// Numeric loops, as bench/runtime/numeric.miaow
+#include <stdio.h>
+#include <stdlib.h>
+
+// As miaow's ->S prints a Float: the fewest significant digits that read back as the same float
+// (%g matches its fixed notation for the sum printed here)
+static void print_float(float f) {
+    char buf[32];
+    for (int precision = 1; precision <= 9; precision++) {
+        snprintf(buf, sizeof buf, "%.*g", precision, f);
+        if (strtof(buf, NULL) == f) break;
+    }
+    puts(buf);
+}
+
+int main(void) {
+    int steps = 0;
+    for (int round = 0; round < 10; round++) {
+        for (int n = 1; n < 100000; n++) {
+            int x = n;
+            while (x != 1) {
+                if (x % 2 == 0) x = x / 2;
+                else x = x * 3 + 1;
+                steps++;
+            }
+        }
+    }
+    printf("%d\n", steps);
+    // Float in miaow is single precision
+    float sum = 0.0f;
+    for (float k = 1.0f; k < 4000000.0f; k += 1.0f) sum += 1.0f / (k * k);
+    print_float(sum);
+    return 0;
+}
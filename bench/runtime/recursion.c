@@ -0,0 +1,19 @@
+// Recursive functions, as bench/runtime/recursion.miaow
+#include <stdio.h>
+
+static int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+static int ack(int m, int n) {
+    if (m == 0) return n + 1;
+    if (n == 0) return ack(m - 1, 1);
+    return ack(m - 1, ack(m, n - 1));
+}
+
+int main(void) {
+    printf("%d\n", fib(35));
+    printf("%d\n", ack(2, 2000));
+    return 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/sh
+# Runtime benchmark (make bench-runtime).
+#
+# Every kernel in bench/runtime (NAME.miaow, with its C reference NAME.c) is built with miaow and
+# with the C compiler at each -O level. Both builds must print the same. Each is then run RUNS
+# times with its output sent to /dev/null, and the median wall time and peak RSS are reported.
+# Prints a table and writes bench/results/runtime.json. "ratio" is miaow's time over C's.
+#
+# Environment: MIAOW (./miaow), CC (cc), MEASURE (measure helper), RUNS (5), LEVELS ("0 1 2 3"),
+# OUT (bench/results)
+set -e
+
+dir=$(dirname "$0")
+MIAOW=${MIAOW:-./miaow}
+CC=${CC:-cc}
+MEASURE=${MEASURE:-$dir/measure}
+RUNS=${RUNS:-5}
+LEVELS=${LEVELS:-0 1 2 3}
+OUT=${OUT:-bench/results}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+mkdir -p "$OUT"
+: > "$work/times.tsv"
+
+for source in "$dir"/*.miaow; do
+    kernel=$(basename "$source" .miaow)
+    for level in $LEVELS; do
+        "$MIAOW" "$source" --emit=exe -O"$level" -o "$work/$kernel.miaow"
+        "$CC" -O"$level" "$dir/$kernel.c" -o "$work/$kernel.c"
+
+        # Different output means the kernels do different work, and the times can't be compared
+        "$work/$kernel.miaow" > "$work/miaow.out"
+        "$work/$kernel.c" > "$work/c.out"
+        if ! cmp -s "$work/miaow.out" "$work/c.out"; then
+            echo "Error: $kernel at -O$level prints different output with miaow and C" >&2
+            exit 1
+        fi
+
+        for lang in miaow c; do
+            run=0
+            while [ $run -lt "$RUNS" ]; do
+                set -- $("$MEASURE" /dev/null "$work/$kernel.$lang")
+                printf '%s\t%s\t%s\t%s\t%s\n' "$kernel" "$level" "$lang" "$1" "$2" >> "$work/times.tsv"
+                run=$((run + 1))
+            done
+        done
+    done
+done
+
+awk -F '\t' -v json="$OUT/runtime.json" -v runs="$RUNS" '
+    function median(list,    values, n, i, j, v) {
+        n = split(list, values, " ")
+        for (i = 2; i <= n; i++) {
+            v = values[i] + 0
+            for (j = i - 1; j >= 1 && values[j] + 0 > v; j--) values[j + 1] = values[j]
+            values[j + 1] = v
+        }
+        return n % 2 ? values[(n + 1) / 2] : (values[n / 2] + values[n / 2 + 1]) / 2
+    }
+    {
+        key = $1 SUBSEP $2
+        if (!(key in seen)) { seen[key] = 1; keys[++nkeys] = key }
+        wall[key, $3] = wall[key, $3] " " $4
+        rss[key, $3] = rss[key, $3] " " $5
+    }
+    END {
+        printf "%-12s %3s %12s %12s %8s %14s %14s\n", "kernel", "-O", "miaow ms", "C ms", "ratio", "miaow rss KB", "C rss KB"
+        printf "{\"runs\": %d, \"results\": [", runs > json
+        for (k = 1; k <= nkeys; k++) {
+            split(keys[k], parts, SUBSEP)
+            miaow_ms = median(wall[keys[k], "miaow"]); c_ms = median(wall[keys[k], "c"])
+            miaow_kb = median(rss[keys[k], "miaow"]); c_kb = median(rss[keys[k], "c"])
+            ratio = c_ms > 0 ? miaow_ms / c_ms : 0
+            printf "%-12s %3s %12.3f %12.3f %8.2f %14d %14d\n", parts[1], parts[2], miaow_ms, c_ms, ratio, miaow_kb, c_kb
+            printf "%s\n  {\"kernel\": \"%s\", \"opt_level\": %s, \"ratio\": %.3f, " \
+                   "\"miaow\": {\"median_ms\": %.3f, \"peak_rss_kb\": %d}, \"c\": {\"median_ms\": %.3f, \"peak_rss_kb\": %d}}",
+                   (k > 1 ? "," : ""), parts[1], parts[2], ratio, miaow_ms, miaow_kb, c_ms, c_kb > json
+        }
+        printf "\n]}\n" > json
+        printf "\nresults written to %s\n", json
+    }' "$work/times.tsv"
@@ -0,0 +1,35 @@
+// String building, as bench/runtime/strings.miaow, on a growable char buffer
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    int size;
+    int capacity;
+    char* data;
+} Str;
+
+static void append(Str* s, char c) {
+    if (s->size + 1 >= s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 1;
+        s->data = realloc(s->data, s->capacity);
+    }
+    s->data[s->size++] = c;
+    s->data[s->size] = '\0';
+}
+
+int main(void) {
+    int total = 0;
+    for (int round = 0; round < 20; round++) {
+        Str s = {0, 0, NULL};
+        for (int i = 0; i < 100000; i++) {
+            char digits[12];
+            int n = sprintf(digits, "%d", i);
+            for (int j = 0; j < n; j++) append(&s, digits[j]);
+            append(&s, ',');
+        }
+        total += s.size;
+        free(s.data);
+    }
+    printf("%d\n", total);
+    return 0;
+}
@@ -0,0 +1,29 @@
+// Struct-heavy loop, as bench/runtime/structs.miaow
+#include <stdio.h>
+
+typedef struct {
+    int x, y, vx, vy;
+} Body;
+
+static int energy(const Body* b) {
+    return b->vx * b->vx + b->vy * b->vy;
+}
+
+int main(void) {
+    Body a = {0, 0, 3, 1};
+    Body b = {100, 50, -2, 5};
+    int checksum = 0;
+    for (int step = 0; step < 20000000; step++) {
+        a.x += a.vx;
+        a.y += a.vy;
+        b.x += b.vx;
+        b.y += b.vy;
+        if (a.x > 1000) a.vx = -a.vx;
+        if (a.x < 0) a.vx = -a.vx;
+        if (b.y > 1000) b.vy = -b.vy;
+        if (b.y < 0) b.vy = -b.vy;
+        checksum = (checksum + energy(&a) + energy(&b) + a.x + b.y) % 1000003;
+    }
+    printf("%d\n", checksum);
+    return 0;
+}
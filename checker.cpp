@@ -0,0 +1,416 @@
+#include "checker.hpp"
+#include "compiler.hpp"
+#include "session.hpp"
+
+// Unannotated fun/extern parameters and return values are Var
+static TypeRef declared(TypeRef type) {
+    return type ? type : VAR_TYPE;
+}
+
+static std::string type_name(TypeRef type) {
+    return type ? type->name.str() : "?";
+}
+
+// Whether a value of type `actual` can be stored where `expected` is declared
+static bool assignable(TypeRef expected, TypeRef actual) {
+    if (expected == actual || expected == VAR_TYPE || actual == VAR_TYPE) return true;
+    // Int literals double as Char and Bool (e.g. (append s 33))
+    if (actual == INT_TYPE && (expected == CHAR_TYPE || expected == BOOL_TYPE)) return true;
+    // An empty array literal fits any array
+    return expected->kind == TypeKind::Array && actual == array_type_of(NIL_TYPE);
+}
+
+static bool is_number(TypeRef type) {
+    return type == INT_TYPE || type == FLOAT_TYPE || type == VAR_TYPE;
+}
+
+// Str or Array<T>: what len, get, set, append and the other array intrinsics work on
+static bool is_sequence(TypeRef type) {
+    return type == VAR_TYPE || type->kind == TypeKind::Str || type->kind == TypeKind::Array;
+}
+
+// Numbers, true, false and nil; any other unquoted atom names a variable
+static bool is_literal(const Atom& atom) {
+    const std::string& id = atom.identifier;
+    if (id.empty() || isdigit(id[0]) || (id[0] == '-' && id.size() > 1 && isdigit(id[1]))) return true;
+    return id == "true" || id == "false" || id == "nil";
+}
+
+class TypeChecker {
+public:
+    int errors = 0;
+
+    explicit TypeChecker(const std::unordered_map<std::string, TypeRef>& globals) {
+        scopes.emplace_back();
+        for (auto& [name, type] : globals) {
+            bind(Symbol(name), type);
+        }
+    }
+
+    TypeRef check(Particle& p) {
+        if (std::holds_alternative<Atom>(p)) return check_atom(std::get<Atom>(p));
+        return check_molecule(std::get<Molecule>(p));
+    }
+
+private:
+    // Variables by interned name; the program's variables, then one scope per fun and block being checked
+    typedef std::unordered_map<const std::string*, TypeRef> Scope;
+    std::vector<Scope> scopes;
+    std::vector<TypeRef> return_types;  // of the funs being checked, innermost last
+
+    void error(const Particle& at, const std::string& message) {
+        std::visit([&](auto&& node) {
+            std::cerr << "Error: " << session->line_map.locate(node.line) << ":" << node.col << ": " << message << std::endl;
+        }, at);
+        errors++;
+    }
+
+    void error(const Molecule& at, const std::string& message) {
+        std::cerr << "Error: " << session->line_map.locate(at.line) << ":" << at.col << ": " << message << std::endl;
+        errors++;
+    }
+
+    void bind(const Symbol& name, TypeRef type) {
+        scopes.back()[&name.str()] = type;
+    }
+
+    // nullptr if no variable of that name is in scope
+    TypeRef lookup(const Symbol& name) {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto var = scope->find(&name.str());
+            if (var != scope->end()) return var->second;
+        }
+        return nullptr;
+    }
+
+    // The fun/extern of that name, declared in this program or an earlier REPL input
+    Function* fun_named(const Symbol& name) {
+        auto fn = session->intrinsics.find(name);
+        return fn != session->intrinsics.end() && fn->second.signature ? &fn->second : nullptr;
+    }
+
+    // Keeps an annotation (Int:(...), Person:[...]) over the inferred type
+    TypeRef set_type(Molecule& mol, TypeRef type) {
+        if (!mol.type) mol.type = type;
+        return mol.type;
+    }
+
+    TypeRef check_atom(Atom& atom) {
+        if (atom.quoted) return atom.type;
+        if (is_literal(atom)) {
+            if (!atom.type) atom.type = atom.get_type();
+            return atom.type;
+        }
+        if (atom.type) return atom.type;  // annotated literal, e.g. Char:33
+
+        TypeRef var_type = lookup(atom.identifier);
+        if (!var_type) {
+            error(atom, "undefined variable '" + atom.identifier.str() + "'");
+            return VAR_TYPE;
+        }
+
+        if (!atom.member_access.empty()) {
+            if (!is_struct_type(var_type)) {
+                error(atom, "'" + atom.identifier.str() + "' is " + type_name(var_type) + ", not a struct");
+                return VAR_TYPE;
+            }
+            const StructDef& def = *var_type->struct_def();
+            for (size_t i = 0; i < def.field_names.size(); i++) {
+                if (def.field_names[i] == atom.member_access.str()) {
+                    atom.type = def.field_types[i];
+                    return atom.type;
+                }
+            }
+            error(atom, "struct " + def.name + " has no field '" + atom.member_access.str() + "'");
+            return VAR_TYPE;
+        }
+
+        atom.type = var_type;
+        return var_type;
+    }
+
+    TypeRef check_molecule(Molecule& mol) {
+        if (mol.atoms.empty()) return set_type(mol, NIL_TYPE);
+        if (!std::holds_alternative<Atom>(mol.subject())) {
+            for (auto& child : mol.atoms) check(child);
+            return set_type(mol, NIL_TYPE);
+        }
+
+        const Symbol& subj = std::get<Atom>(mol.subject()).identifier;
+        if (subj == "def") return check_def(mol);
+        if (subj == "=") return check_reassign(mol);
+        if (subj == "fun") return check_fun(mol, false);
+        if (subj == "extern" || subj == "declare") return check_fun(mol, true);
+        if (subj == "overload") return check_overload(mol);
+        // Already declared by collect_struct_declarations
+        if (subj == "struct" || subj == "extern-struct") return set_type(mol, NIL_TYPE);
+
+        // defs inside a block are only visible in it
+        bool is_block = (subj == "block");
+        if (is_block) scopes.emplace_back();
+        std::vector<TypeRef> arg_types;
+        for (size_t i = 1; i < mol.atoms.size(); i++) {
+            arg_types.push_back(check(mol.atoms[i]));
+        }
+        if (is_block) scopes.pop_back();
+
+        if (is_block || subj == "if" || subj == "while" || subj == "web-loop") {
+            return set_type(mol, NIL_TYPE);
+        }
+        if (subj == "array" && mol.type && mol.type->kind == TypeKind::Struct) {
+            return check_struct_literal(mol, arg_types);
+        }
+        if (subj == "return" && !return_types.empty() && !arg_types.empty() &&
+            !assignable(return_types.back(), arg_types[0])) {
+            error(mol.atoms[1], "returning " + type_name(arg_types[0]) + " from a fun declared to return " +
+                  type_name(return_types.back()));
+        }
+        if (subj == "meowf") {
+            for (size_t i = 0; i < arg_types.size(); i++) {
+                TypeRef t = arg_types[i];
+                if (t != STR_TYPE && t != INT_TYPE && t != FLOAT_TYPE && t != CHAR_TYPE && t != BOOL_TYPE) {
+                    error(mol.atoms[i + 1], "meowf cannot print " + type_name(t) + " (expected Str, Int, Float, Char or Bool)");
+                }
+            }
+        }
+        return check_call(mol, subj, arg_types);
+    }
+
+    // (def Type:name) or (def Type:name value)
+    TypeRef check_def(Molecule& mol) {
+        TypeRef value_type = nullptr;
+        if (mol.atoms.size() >= 3) value_type = check(mol.atoms[2]);
+
+        if (mol.atoms.size() < 2 || !std::holds_alternative<Atom>(mol.atoms[1])) {
+            error(mol, "def expects a typed name (e.g., def Int:x 5)");
+            return set_type(mol, NIL_TYPE);
+        }
+        Atom& var = std::get<Atom>(mol.atoms[1]);
+        if (!var.type) {
+            error(var, "def requires type annotation (e.g., def Int:x or def Int:x 5)");
+            return set_type(mol, NIL_TYPE);
+        }
+        auto same_scope = scopes.back().find(&var.identifier.str());
+        if (same_scope != scopes.back().end() && same_scope->second != var.type) {
+            error(var, "'" + var.identifier.str() + "' is already defined as " + type_name(same_scope->second) +
+                  " in this scope, cannot redefine it as " + type_name(var.type));
+        } else if (var.type->kind == TypeKind::Struct && !var.type->struct_def()) {
+            error(var, "unknown type '" + type_name(var.type) + "'");
+        } else if (value_type && !assignable(var.type, value_type)) {
+            error(mol.atoms[2], "cannot initialize " + type_name(var.type) + " variable '" + var.identifier.str() +
+                  "' with " + type_name(value_type));
+        }
+        bind(var.identifier, var.type);
+        return set_type(mol, var.type);
+    }
+
+    // (= name value)
+    TypeRef check_reassign(Molecule& mol) {
+        if (mol.atoms.size() < 3 || !std::holds_alternative<Atom>(mol.atoms[1])) {
+            error(mol, "= expects a variable and a value");
+            return set_type(mol, NIL_TYPE);
+        }
+        TypeRef value_type = check(mol.atoms[2]);
+        Atom& var = std::get<Atom>(mol.atoms[1]);
+        if (!lookup(var.identifier)) {
+            error(var, "variable '" + var.identifier.str() + "' not defined. Use def to declare.");
+            return set_type(mol, NIL_TYPE);
+        }
+        TypeRef var_type = check_atom(var);
+        if (!assignable(var_type, value_type)) {
+            error(mol.atoms[2], "cannot assign " + type_name(value_type) + " to " + type_name(var_type) +
+                  " variable '" + var.identifier.str() + "'");
+        }
+        return set_type(mol, var_type);
+    }
+
+    // (fun Ret:(name Type:param ...) { body }), or (extern/declare Ret:(name Type:param ...)) with no body
+    TypeRef check_fun(Molecule& mol, bool is_extern) {
+        if (mol.atoms.size() < (is_extern ? 2u : 3u) || !std::holds_alternative<Molecule>(mol.atoms[1])) {
+            error(mol, is_extern ? std::get<Atom>(mol.subject()).identifier.str() + " expects a signature"
+                                 : "fun expects a signature and a body");
+            return set_type(mol, NIL_TYPE);
+        }
+        Molecule& sig = std::get<Molecule>(mol.atoms[1]);
+        if (sig.atoms.empty() || !std::holds_alternative<Atom>(sig.subject())) {
+            error(sig, "expected a fun name");
+            return set_type(mol, NIL_TYPE);
+        }
+
+        scopes.emplace_back();
+        for (size_t i = 1; i < sig.atoms.size(); i++) {
+            Atom& param = std::get<Atom>(sig.atoms[i]);
+            bind(param.identifier, declared(param.type));
+        }
+
+        // Registered before the body is checked, so a fun can call itself
+        TypeRef return_type = declared(sig.type);
+        register_signature(mol);
+
+        if (!is_extern) {
+            return_types.push_back(return_type);
+            check(mol.atoms[2]);
+            return_types.pop_back();
+        }
+        scopes.pop_back();
+        return set_type(mol, NIL_TYPE);
+    }
+
+    // (overload op method) or (overload op [m1 m2 ...])
+    TypeRef check_overload(Molecule& mol) {
+        if (mol.atoms.size() < 3 || !std::holds_alternative<Atom>(mol.atoms[1])) {
+            error(mol, "overload expects an operator and its methods");
+            return set_type(mol, NIL_TYPE);
+        }
+        const Symbol& op = std::get<Atom>(mol.atoms[1]).identifier;
+        auto add_method = [&](Particle& p) {
+            const Symbol& method = std::get<Atom>(p).identifier;
+            if (Function* fn = fun_named(method)) {
+                register_overload(op, fn);
+            } else {
+                error(p, "unknown fun '" + method.str() + "'");
+            }
+        };
+
+        if (std::holds_alternative<Atom>(mol.atoms[2])) {
+            add_method(mol.atoms[2]);
+        } else {
+            Molecule& list = std::get<Molecule>(mol.atoms[2]);
+            for (size_t i = 1; i < list.atoms.size(); i++) {
+                add_method(list.atoms[i]);
+            }
+        }
+        return set_type(mol, NIL_TYPE);
+    }
+
+    // Person:["bob" 67]
+    TypeRef check_struct_literal(Molecule& mol, const std::vector<TypeRef>& field_types) {
+        if (!mol.type->struct_def()) {
+            error(mol, "unknown type '" + type_name(mol.type) + "'");
+            return mol.type;
+        }
+        const StructDef& def = *mol.type->struct_def();
+        if (field_types.size() != def.field_types.size()) {
+            error(mol, "struct " + def.name + " has " + std::to_string(def.field_types.size()) + " fields, got " +
+                  std::to_string(field_types.size()));
+            return mol.type;
+        }
+        for (size_t i = 0; i < field_types.size(); i++) {
+            if (!assignable(def.field_types[i], field_types[i])) {
+                error(mol.atoms[i + 1], "field '" + def.field_names[i] + "' of " + def.name + " is " +
+                      type_name(def.field_types[i]) + ", got " + type_name(field_types[i]));
+            }
+        }
+        return mol.type;
+    }
+
+    void check_args(Molecule& mol, const Symbol& name, TypeRef signature, const std::vector<TypeRef>& arg_types) {
+        const std::vector<TypeRef>& param_types = signature->param_types;
+        if (param_types.size() != arg_types.size()) {
+            error(mol, "'" + name.str() + "' takes " + std::to_string(param_types.size()) + " arguments, got " +
+                  std::to_string(arg_types.size()));
+            return;
+        }
+        for (size_t i = 0; i < arg_types.size(); i++) {
+            if (!assignable(param_types[i], arg_types[i])) {
+                error(mol.atoms[i + 1], "argument " + std::to_string(i + 1) + " of '" + name.str() + "' is " +
+                      type_name(arg_types[i]) + ", expected " + type_name(param_types[i]));
+            }
+        }
+    }
+
+    // Operand rules of the intrinsics, which have no fun signature to check against. Reports every
+    // operand that breaks them; returns false if there were any.
+    bool check_operands(Molecule& mol, const std::string& name, const std::vector<TypeRef>& arg_types) {
+        int errors_before = errors;
+        auto arity = [&](size_t count) {
+            if (arg_types.size() == count) return true;
+            error(mol, "'" + name + "' takes " + std::to_string(count) + " arguments, got " + std::to_string(arg_types.size()));
+            return false;
+        };
+        auto expect = [&](size_t i, bool ok, const std::string& expected) {
+            if (!ok) {
+                error(mol.atoms[i + 1], "argument " + std::to_string(i + 1) + " of '" + name + "' is " +
+                      type_name(arg_types[i]) + ", expected " + expected);
+            }
+        };
+        auto expect_bool = [&](size_t i) { expect(i, arg_types[i] == BOOL_TYPE || arg_types[i] == VAR_TYPE, "Bool"); };
+        auto expect_index = [&](size_t i) { expect(i, assignable(INT_TYPE, arg_types[i]), "an Int index"); };
+        // An element of the Str or array that is the first operand
+        auto expect_element = [&](size_t i) {
+            TypeRef element = arg_types[0] == VAR_TYPE ? VAR_TYPE : array_element_type(arg_types[0]);
+            expect(i, assignable(element, arg_types[i]), type_name(element));
+        };
+
+        if (name == "+" || name == "-" || name == "*" || name == "/" || name == "%" || name == "+=" || name == "-=" ||
+            name == "==" || name == "!=" || name == ">" || name == ">=" || name == "<" || name == "<=") {
+            if (arity(2)) {
+                expect(0, is_number(arg_types[0]), "Int or Float");
+                expect(1, is_number(arg_types[1]) && assignable(arg_types[0], arg_types[1]), type_name(arg_types[0]));
+            }
+        } else if (name == "++" || name == "--" || name == "eat" || name == "exercise") {
+            if (arity(1)) expect(0, is_number(arg_types[0]), "Int or Float");
+        } else if (name == "!") {
+            if (arity(1)) expect_bool(0);
+        } else if (name == "&&" || name == "||") {
+            if (arity(2)) {
+                expect_bool(0);
+                expect_bool(1);
+            }
+        } else if (name == "meow" || name == "->I") {
+            if (arity(1)) expect(0, arg_types[0] == STR_TYPE || arg_types[0] == VAR_TYPE, "Str");
+        } else if (name == "->S") {
+            if (arity(1)) {
+                TypeRef t = arg_types[0];
+                expect(0, t == INT_TYPE || t == FLOAT_TYPE || t == CHAR_TYPE || t == BOOL_TYPE || t == VAR_TYPE,
+                       "Int, Float, Char or Bool");
+            }
+        } else if (name == "flush") {
+            arity(0);
+        } else if (name == "len" || name == "pop_back") {
+            if (arity(1)) expect(0, is_sequence(arg_types[0]), "Str or an array");
+        } else if (name == "get" || name == "remove") {
+            if (arity(2)) {
+                expect(0, is_sequence(arg_types[0]), "Str or an array");
+                expect_index(1);
+            }
+        } else if (name == "append") {
+            if (arity(2) && is_sequence(arg_types[0])) {
+                expect_element(1);
+            } else if (arg_types.size() == 2) {
+                expect(0, false, "Str or an array");
+            }
+        } else if (name == "set" || name == "insert") {
+            if (arity(3) && is_sequence(arg_types[0])) {
+                expect_index(1);
+                expect_element(2);
+            } else if (arg_types.size() == 3) {
+                expect(0, false, "Str or an array");
+            }
+        }
+        return errors == errors_before;
+    }
+
+    // Resolves the call once, here: codegen dispatches through mol.callee without looking it up
+    TypeRef check_call(Molecule& mol, const Symbol& name, const std::vector<TypeRef>& arg_types) {
+        Function* fn = resolve_call(mol, arg_types);
+        if (!fn) {
+            error(mol, "unknown function '" + name.str() + "'");
+            return set_type(mol, VAR_TYPE);
+        }
+        if (fn->signature) {
+            check_args(mol, name, fn->signature, arg_types);
+        } else if (!check_operands(mol, name, arg_types)) {
+            return set_type(mol, VAR_TYPE);
+        }
+        return set_type(mol, fn->type_inference(mol.predicate()));
+    }
+};
+
+int typecheck(Molecule& root, const std::unordered_map<std::string, TypeRef>& globals) {
+    TypeChecker checker(globals);
+    for (size_t i = 1; i < root.atoms.size(); i++) {
+        checker.check(root.atoms[i]);
+    }
+    return checker.errors;
+}
@@ -0,0 +1,13 @@
+#ifndef CHECKER_HPP
+#define CHECKER_HPP
+
+#include "types.hpp"
+#include <unordered_map>
+
+// Type check a program in one bottom-up pass before codegen. Every node's type is
+// stored in the node (Atom::type, Molecule::type), so codegen only reads cached types.
+// Errors are printed with their source position; returns how many there were.
+// `globals` are variables defined outside this program (earlier REPL inputs).
+int typecheck(Molecule& root, const std::unordered_map<std::string, TypeRef>& globals = {});
+
+#endif // CHECKER_HPP
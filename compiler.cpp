@@ -1,27 +1,29 @@
 #include "compiler.hpp"
+#include "session.hpp"
+#include "runtime.hpp"
 
 // Helper: Extract char* data pointer from a Str (for passing to C functions)
-static llvm::Value* extract_cstring(llvm::Value* str_ptr_ptr) {
-    llvm::Type* ptr_type = llvm::PointerType::getUnqual(*TheContext);
-    llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-    llvm::StructType* str_struct_type = get_array_struct_type(char_type);
+static llvm::Value* extract_cstring(const StoredValue& str) {
+    llvm::Type* ptr_type = llvm::PointerType::getUnqual(*session->context);
+    llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
     
-    // Load the struct pointer from the pointer-to-pointer
-    llvm::Value* str_ptr = Builder->CreateLoad(ptr_type, str_ptr_ptr, "str_ptr");
+    // Get the struct pointer (loading it if the Str lives in a variable)
+    llvm::Value* str_ptr = load_value(str, ptr_type);
     // Get the data pointer field (index 2)
-    llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
     // Load the actual char* data pointer
-    llvm::Value* data_ptr = Builder->CreateLoad(ptr_type, data_ptr_ptr, "data_ptr");
+    llvm::Value* data_ptr = session->builder->CreateLoad(ptr_type, data_ptr_ptr, "data_ptr");
     return data_ptr;
 }
 
 
-llvm::Value* evaluate(Atom& atom) {
+StoredValue evaluate(Atom& atom) {
     // Handle member access (e.g., bob>name)
-    if (!atom.member_access.empty() && object_registry.count(atom.identifier)) {
-        std::string var_type = object_registry[atom.identifier].type;
-        if (struct_registry.count(var_type)) {
-            StructDef& def = struct_registry[var_type];
+    MemObject* var = atom.member_access.empty() ? nullptr : session->object_registry.find(atom.identifier);
+    if (var) {
+        TypeRef var_type = var->type;
+        if (is_struct_type(var_type)) {
+            StructDef& def = *var_type->struct_def();
             
             // Find field index
             int field_idx = -1;
@@ -34,158 +36,279 @@ llvm::Value* evaluate(Atom& atom) {
             
             if (field_idx >= 0) {
                 // Load struct pointer
-                llvm::Value* struct_ptr_ptr = object_registry[atom.identifier].value;
-                llvm::Value* struct_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), struct_ptr_ptr);
+                llvm::Value* struct_ptr_ptr = var->value;
+                llvm::Value* struct_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), struct_ptr_ptr);
                 
                 // GEP to field
-                llvm::Value* field_ptr = Builder->CreateStructGEP(def.llvm_type, struct_ptr, field_idx);
-                
-                // For Str/struct fields (pointer types), load and wrap in another alloca
-                std::string field_type = def.field_types[field_idx];
-                if (field_type == "Str" || struct_registry.count(field_type)) {
-                    llvm::Value* field_val = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), field_ptr);
-                    llvm::AllocaInst* result = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext));
-                    Builder->CreateStore(field_val, result);
-                    atom.stored_in = result;
+                llvm::Value* field_ptr = session->builder->CreateStructGEP(def.llvm_type, struct_ptr, field_idx);
+                
+                // For Str/struct fields (pointer types), the loaded pointer is the value
+                TypeRef field_type = def.field_types[field_idx];
+                if (field_type == STR_TYPE || is_struct_type(field_type)) {
+                    llvm::Value* field_val = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), field_ptr);
+                    atom.stored_in = StoredValue::rvalue(field_val);
                     atom.type = field_type;
-                    return result;
+                    return atom.stored_in;
                 }
                 
-                atom.stored_in = field_ptr;
+                atom.stored_in = StoredValue::address(field_ptr);
                 atom.type = field_type;
-                return field_ptr;
+                return atom.stored_in;
             }
         }
     }
     
     // Handle string literals BEFORE variable lookup
     // (string literal "bob" becomes identifier "bob" with type "Str")
-    if (atom.type == "Str") {
-        llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-        int size = atom.identifier.size();
-        int capacity = std::pow(2, std::ceil(std::log2(size > 0 ? size + 1 : 1)));
-        
-        llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-        llvm::AllocaInst* str_alloc = Builder->CreateAlloca(str_struct_type, nullptr, "str_struct");
+    if (atom.quoted) {
+        llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+        llvm::Value* str_alloc = create_temporary(str_struct_type, "str_struct");
         
-        llvm::Value* size_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
-        Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), size), size_ptr);
+        llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
+        session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), atom.identifier.size()), size_ptr);
         
-        llvm::Value* cap_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
-        Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), capacity), cap_ptr);
+        llvm::Value* cap_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
+        llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
+        llvm::GlobalVariable* chars = string_literal(atom.identifier);
         
-        llvm::ArrayType* data_array_type = llvm::ArrayType::get(char_type, size + 1);
-        llvm::AllocaInst* data_alloc = Builder->CreateAlloca(data_array_type, nullptr, "str_data");
-        
-        for (int i = 0; i < size; ++i) {
-            std::vector<llvm::Value*> indices = {
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0),
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), i)
-            };
-            llvm::Value* ptr = Builder->CreateInBoundsGEP(data_array_type, data_alloc, indices, "char_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(char_type, (unsigned char)atom.identifier[i]), ptr);
+        if (atom.borrowed) {
+            // Capacity 0: the characters are the read-only constant itself
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0), cap_ptr);
+            session->builder->CreateStore(chars, data_ptr_ptr);
+        } else {
+            // The value may be mutated, so it gets its own copy: one memcpy into a temporary that
+            // backs the whole capacity, so append can fill it before growing
+            int size = atom.identifier.size();
+            int capacity = std::pow(2, std::ceil(std::log2(size + 1)));
+            llvm::ArrayType* data_array_type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*session->context), capacity);
+            llvm::Value* data_alloc = create_temporary(data_array_type, "str_data", str_alloc);
+            session->builder->CreateMemCpy(data_alloc, llvm::MaybeAlign(1), chars, llvm::MaybeAlign(1), size + 1);
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), capacity), cap_ptr);
+            session->builder->CreateStore(data_alloc, data_ptr_ptr);
         }
         
-        std::vector<llvm::Value*> null_indices = {
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0),
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), size)
-        };
-        llvm::Value* null_ptr = Builder->CreateInBoundsGEP(data_array_type, data_alloc, null_indices, "null_ptr");
-        Builder->CreateStore(llvm::ConstantInt::get(char_type, 0), null_ptr);
-        
-        llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
-        llvm::Value* data_ptr = Builder->CreateBitCast(data_alloc, llvm::PointerType::getUnqual(*TheContext));
-        Builder->CreateStore(data_ptr, data_ptr_ptr);
-        
-        llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "str_ref");
-        Builder->CreateStore(str_alloc, result_ptr);
-        
-        atom.stored_in = result_ptr;
-        return result_ptr;
+        atom.stored_in = StoredValue::rvalue(str_alloc);
+        return atom.stored_in;
     }
     
-    if (object_registry.count(atom.identifier)) {
-        llvm::Value* val = object_registry[atom.identifier].value;
-        if (val) {
-            atom.stored_in = val;
-            return val;
+    if (MemObject* var = session->object_registry.find(atom.identifier)) {
+        if (var->value) {
+            atom.stored_in = StoredValue::address(var->value);
+            return atom.stored_in;
         }
     }
     
     llvm::Constant* const_val = get_llvm_constant(atom);
     if (const_val) {
-        llvm::Type* type = const_val->getType();
-        
-        llvm::AllocaInst* alloca = Builder->CreateAlloca(type);
-        Builder->CreateStore(const_val, alloca);
-        atom.stored_in = alloca;
-        return alloca;
+        atom.stored_in = StoredValue::rvalue(const_val);
+        return atom.stored_in;
     }
     
-    return nullptr;
+    return {};
 }
 
-llvm::Value* evaluate(Molecule& mol) {
+StoredValue evaluate(Molecule& mol) {
     if (std::holds_alternative<Atom>(mol.subject())) {
-        Atom subj = std::get<Atom>(mol.subject());
+        const Atom& subj = std::get<Atom>(mol.subject());
         
-        std::vector<llvm::Value*> args;
+        std::vector<StoredValue> args;
         
         for (size_t i = 1; i < mol.atoms.size(); i++) {
             auto& arg = mol.atoms[i];
-            llvm::Value* val = get_stored_in(arg);
+            StoredValue val = get_stored_in(arg);
             if (val) {
                 args.push_back(val);
             }
         }
     
-        std::string fn_name = subj.identifier;
+        // Usually already resolved by the type pass
+        Function* fn = resolve_call(mol);
+        if (fn) {
+            IntrinsicResult result = fn->evaluate(mol, args);
+            mol.stored_in = result;
+            if (fn->identifier != subj.identifier) {
+                // Matched an overload: the molecule has the overload's return type
+                mol.type = fn->type_inference(mol.predicate());
+            }
+            return result;
+        }
+    }
+    return {};
+}
 
-        // Check overloads first
-        if (overload_registry.count(fn_name)) {
-            // Get argument types
-            std::vector<std::string> arg_types;
-            for (size_t i = 1; i < mol.atoms.size(); i++) {
-                arg_types.push_back(get_particle_type(mol.atoms[i]));
+// Make a miaow fun callable by name, with miaow's calling convention (unlike extern)
+static Function* register_fun(const std::string& func_name, TypeRef return_type, const std::vector<TypeRef>& param_types) {
+    std::vector<llvm::Type*> llvm_param_types;
+    for (TypeRef param_type : param_types) {
+        llvm_param_types.push_back(get_llvm_type(param_type));
+    }
+    llvm::Type* llvm_ret_type = get_llvm_type(return_type);
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm_ret_type, llvm_param_types, false);
+    
+    Function fn(func_name, 
+        [func_name, FT, llvm_param_types, llvm_ret_type](Molecule& call_mol, const std::vector<StoredValue>& args) -> IntrinsicResult {
+            std::vector<llvm::Value*> call_args;
+            for (size_t i = 0; i < args.size(); i++) {
+                call_args.push_back(load_value(args[i], llvm_param_types[i]));
             }
-            
-            // Find matching overload
-            for (const std::string& candidate : overload_registry[fn_name]) {
-                if (INTRINSICS.count(candidate)) {
-                    Function& fn = INTRINSICS[candidate];
-                    if (fn.param_types.size() == arg_types.size()) {
-                        bool match = true;
-                        for (size_t i = 0; i < arg_types.size(); i++) {
-                            if (fn.param_types[i] != arg_types[i]) {
-                                match = false;
-                                break;
-                            }
-                        }
-                        if (match) {
-                            IntrinsicResult result = fn.evaluate(mol, args);
-                            mol.stored_in = result.value;
-                            // Set the molecule's type from the matched function's type inference
-                            std::vector<Particle> type_args(mol.atoms.begin() + 1, mol.atoms.end());
-                            mol.type = fn.type_inference(type_args);
-                            return result.value;
-                        }
+            // Resolve by name: the caller may live in a later module than the fun (REPL, --module)
+            llvm::FunctionCallee callee = session->module->getOrInsertFunction(func_name, FT);
+            llvm::Value* result = session->builder->CreateCall(callee, call_args);
+            if (llvm_ret_type->isVoidTy()) {
+                return {};
+            }
+            return StoredValue::rvalue(result);
+        },
+        [return_type](const List&) { return return_type; }
+    );
+    fn.signature = function_type(return_type, param_types);  // For overload matching
+    Function& registered = session->intrinsics[func_name];
+    registered = fn;
+    return &registered;
+}
+
+// Make an external C function callable: Str arguments are passed as char*, small extern structs as integers (C ABI)
+static Function* register_extern(Molecule& sig) {
+    TypeRef return_type = sig.type ? sig.type : VAR_TYPE;
+    std::string func_name = std::get<Atom>(sig.atoms[0]).identifier;
+    
+    // Collect parameter types
+    std::vector<TypeRef> param_types;
+    std::vector<llvm::Type*> llvm_param_types;
+    
+    for (size_t i = 1; i < sig.atoms.size(); i++) {
+        Atom& param = std::get<Atom>(sig.atoms[i]);
+        TypeRef param_type = param.type ? param.type : VAR_TYPE;
+        param_types.push_back(param_type);
+        // For Str params passed to C, use ptr (char*)
+        if (param_type == STR_TYPE) {
+            llvm_param_types.push_back(llvm::PointerType::getUnqual(*session->context));
+        } else if (is_struct_type(param_type) && param_type->struct_def()->is_extern) {
+            // Extern structs on x86_64: small structs (<=8 bytes) passed as integers
+            // For a 4-byte struct like Color, C ABI uses i32
+            StructDef& sdef = *param_type->struct_def();
+            // Calculate actual size based on field types
+            size_t byte_size = 0;
+            for (TypeRef ft : sdef.field_types) {
+                if (ft == CHAR_TYPE) byte_size += 1;
+                else if (ft == INT_TYPE) byte_size += 4;
+                else if (ft == FLOAT_TYPE) byte_size += 4;
+                else if (ft == BOOL_TYPE) byte_size += 1;
+                else byte_size += 8; // pointer types
+            }
+            if (byte_size <= 4) {
+                llvm_param_types.push_back(llvm::Type::getInt32Ty(*session->context));
+            } else if (byte_size <= 8) {
+                llvm_param_types.push_back(llvm::Type::getInt64Ty(*session->context));
+            } else {
+                // Larger structs passed by pointer
+                llvm_param_types.push_back(llvm::PointerType::getUnqual(*session->context));
+            }
+        } else {
+            llvm_param_types.push_back(get_llvm_type(param_type));
+        }
+    }
+    
+    llvm::Type* llvm_ret_type = get_llvm_type(return_type);
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm_ret_type, llvm_param_types, false);
+    
+    // Register as intrinsic for calling
+    std::vector<TypeRef> captured_param_types = param_types;
+    Function fn(func_name, 
+        [func_name, FT, captured_param_types, llvm_ret_type](Molecule& call_mol, const std::vector<StoredValue>& args) -> IntrinsicResult {
+            (void)call_mol; // unused
+            std::vector<llvm::Value*> call_args;
+            for (size_t i = 0; i < args.size(); i++) {
+                if (captured_param_types[i] == STR_TYPE) {
+                    // Extract char* from Str struct
+                    call_args.push_back(extract_cstring(args[i]));
+                } else if (is_struct_type(captured_param_types[i]) && 
+                           captured_param_types[i]->struct_def()->is_extern) {
+                    // Coerce extern struct to integer for C ABI
+                    StructDef& sdef = *captured_param_types[i]->struct_def();
+                    size_t byte_size = 0;
+                    for (TypeRef ft : sdef.field_types) {
+                        if (ft == CHAR_TYPE) byte_size += 1;
+                        else if (ft == INT_TYPE) byte_size += 4;
+                        else if (ft == FLOAT_TYPE) byte_size += 4;
+                        else if (ft == BOOL_TYPE) byte_size += 1;
+                        else byte_size += 8;
                     }
+                    // Extern struct values always live in memory (literal or variable)
+                    if (byte_size <= 4) {
+                        // Reinterpret the struct's memory as i32
+                        llvm::Value* loaded = session->builder->CreateLoad(llvm::Type::getInt32Ty(*session->context), args[i].value);
+                        call_args.push_back(loaded);
+                    } else if (byte_size <= 8) {
+                        llvm::Value* loaded = session->builder->CreateLoad(llvm::Type::getInt64Ty(*session->context), args[i].value);
+                        call_args.push_back(loaded);
+                    } else {
+                        // Pass pointer for large structs
+                        call_args.push_back(args[i].value);
+                    }
+                } else {
+                    // Primitive value
+                    llvm::Type* arg_type = get_llvm_type(captured_param_types[i]);
+                    call_args.push_back(load_value(args[i], arg_type));
                 }
             }
-        }
+            llvm::FunctionCallee extern_func = session->module->getOrInsertFunction(func_name, FT);
+            llvm::Value* result = session->builder->CreateCall(extern_func, call_args);
+            if (llvm_ret_type->isVoidTy()) {
+                return {};
+            }
+            return StoredValue::rvalue(result);
+        },
+        [return_type](const List&) { return return_type; }
+    );
+    fn.signature = function_type(return_type, param_types);
+    Function& registered = session->intrinsics[func_name];
+    registered = fn;
+    return &registered;
+}
 
-        // Fall back to original intrinsic
-        if (INTRINSICS.count(fn_name)) {
-            IntrinsicResult result = INTRINSICS.at(fn_name).evaluate(mol, args);
-            mol.stored_in = result.value;
-            return result.value;
-        }
+Function* register_signature(Molecule& mol) {
+    const std::string& subj = std::get<Atom>(mol.subject()).identifier;
+    Molecule& sig = std::get<Molecule>(mol.atoms[1]);
+    if (subj == "extern") return register_extern(sig);
+
+    TypeRef return_type = sig.type ? sig.type : VAR_TYPE;
+    std::vector<TypeRef> param_types;
+    for (size_t i = 1; i < sig.atoms.size(); i++) {
+        Atom& param = std::get<Atom>(sig.atoms[i]);
+        param_types.push_back(param.type ? param.type : VAR_TYPE);
+    }
+    return register_fun(std::get<Atom>(sig.atoms[0]).identifier, return_type, param_types);
+}
+
+void register_overload(const std::string& op_name, Function* method) {
+    // The first method declared for a parameter list wins
+    session->overload_registry[op_name].emplace(method->signature->param_types, method);
+}
+
+// Register a struct whose fields are the typed atoms of fields_mol (after its leading "array")
+static void declare_struct(const std::string& struct_name, Molecule& fields_mol, bool is_extern) {
+    StructDef def;
+    def.name = struct_name;
+    def.is_extern = is_extern;
+    
+    std::vector<llvm::Type*> llvm_field_types;
+    for (size_t i = 1; i < fields_mol.atoms.size(); i++) {
+        Atom& field = std::get<Atom>(fields_mol.atoms[i]);
+        TypeRef field_type = field.type ? field.type : VAR_TYPE;
+        def.field_names.push_back(field.identifier);
+        def.field_types.push_back(field_type);
+        llvm_field_types.push_back(get_llvm_type(field_type));
     }
-    return nullptr;
+    
+    def.llvm_type = llvm::StructType::create(*session->context, llvm_field_types, struct_name);
+    StructDef& registered = session->struct_registry[struct_name];
+    registered = def;
+    session->cache(lookup_type(struct_name)).struct_def = &registered;
 }
 
-// Pass 1.5: Collect struct declarations before variable hoisting
-// This populates struct_registry so hoisting can use correct types
+// Pass 1: Collect struct declarations before type checking
+// This populates the session's struct_registry so member access and struct literals can be typed
 void collect_struct_declarations(Particle& p) {
     if (std::holds_alternative<Molecule>(p)) {
         Molecule& mol = std::get<Molecule>(p);
@@ -197,42 +320,19 @@ void collect_struct_declarations(Particle& p) {
             if (subj == "extern-struct" && mol.atoms.size() >= 3) {
                 // (extern-struct Color [Char:r Char:g Char:b Char:a])
                 std::string struct_name = std::get<Atom>(mol.atoms[1]).identifier;
-                Molecule& fields_mol = std::get<Molecule>(mol.atoms[2]);
-                
-                StructDef def;
-                def.name = struct_name;
-                def.is_extern = true;
-                
-                std::vector<llvm::Type*> llvm_field_types;
-                for (size_t i = 1; i < fields_mol.atoms.size(); i++) {
-                    Atom& field = std::get<Atom>(fields_mol.atoms[i]);
-                    def.field_names.push_back(field.identifier);
-                    def.field_types.push_back(field.type);
-                    llvm_field_types.push_back(get_llvm_type(field.type));
-                }
-                
-                def.llvm_type = llvm::StructType::create(*TheContext, llvm_field_types, struct_name);
-                struct_registry[struct_name] = def;
+                declare_struct(struct_name, std::get<Molecule>(mol.atoms[2]), true);
                 return;
             } else if (subj == "struct" && mol.atoms.size() >= 3) {
                 // (struct Person [Str:name Int:age Bool:active])
                 std::string struct_name = std::get<Atom>(mol.atoms[1]).identifier;
-                Molecule& fields_mol = std::get<Molecule>(mol.atoms[2]);
-                
-                StructDef def;
-                def.name = struct_name;
-                def.is_extern = false;
-                
-                std::vector<llvm::Type*> llvm_field_types;
-                for (size_t i = 1; i < fields_mol.atoms.size(); i++) {
-                    Atom& field = std::get<Atom>(fields_mol.atoms[i]);
-                    def.field_names.push_back(field.identifier);
-                    def.field_types.push_back(field.type);
-                    llvm_field_types.push_back(get_llvm_type(field.type));
+                declare_struct(struct_name, std::get<Molecule>(mol.atoms[2]), false);
+                return;
+            } else if (subj == "struct" && mol.atoms.size() == 2 && std::holds_alternative<Molecule>(mol.atoms[1])) {
+                // (struct Person:[Str:name Int:age Bool:active])
+                Molecule& fields_mol = std::get<Molecule>(mol.atoms[1]);
+                if (fields_mol.type && !session->struct_registry.count(fields_mol.type->name)) {
+                    declare_struct(fields_mol.type->name, fields_mol, false);
                 }
-                
-                def.llvm_type = llvm::StructType::create(*TheContext, llvm_field_types, struct_name);
-                struct_registry[struct_name] = def;
                 return;
             }
         }
@@ -244,34 +344,6 @@ void collect_struct_declarations(Particle& p) {
     }
 }
 
-void collect_variables(Particle& p, std::unordered_map<std::string, std::string>& vars) {
-    if (std::holds_alternative<Molecule>(p)) {
-        Molecule& mol = std::get<Molecule>(p);
-        if (mol.atoms.empty()) return;
-        
-        if (std::holds_alternative<Atom>(mol.subject())) {
-            std::string subj = std::get<Atom>(mol.subject()).identifier;
-            
-            // Only def is for declaration; = is for reassignment
-            if (subj == "def" && mol.atoms.size() >= 2) {
-                if (std::holds_alternative<Atom>(mol.atoms[1])) {
-                    Atom& var_atom = std::get<Atom>(mol.atoms[1]);
-                    std::string var_name = var_atom.identifier;
-                    std::string var_type = var_atom.type;  // Type annotation required for def
-                    
-                    if (!var_type.empty() && var_type != "Str" && !vars.count(var_name)) {
-                        vars[var_name] = var_type;
-                    }
-                }
-            }
-        }
-        
-        for (size_t i = 1; i < mol.atoms.size(); i++) {
-            collect_variables(mol.atoms[i], vars);
-        }
-    }
-}
-
 void compile(Particle& p) {
     if (std::holds_alternative<Molecule>(p)) {
         Molecule& mol = std::get<Molecule>(p);
@@ -281,79 +353,80 @@ void compile(Particle& p) {
             std::string subj = std::get<Atom>(mol.subject()).identifier;
             
             if (subj == "block") {
-                llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
-                llvm::BasicBlock* NewBB = llvm::BasicBlock::Create(*TheContext, "block", TheFunction);
-                Builder->CreateBr(NewBB);
-                Builder->SetInsertPoint(NewBB);
+                llvm::Function* TheFunction = session->builder->GetInsertBlock()->getParent();
+                llvm::BasicBlock* NewBB = llvm::BasicBlock::Create(*session->context, "block", TheFunction);
+                session->builder->CreateBr(NewBB);
+                session->builder->SetInsertPoint(NewBB);
                 
+                // defs inside the block go out of scope at its end
+                session->object_registry.push_scope();
                 for (size_t i = 1; i < mol.atoms.size(); i++) {
                     compile(mol.atoms[i]);
                 }
+                session->object_registry.pop_scope();
                 return;
             } else if (subj == "if") {
                 // Compile condition
                 compile(mol.atoms[1]);
-                llvm::Value* cond_ptr = get_stored_in(mol.atoms[1]);
-                // Load condition (expect i1)
-                llvm::Value* cond = Builder->CreateLoad(llvm::Type::getInt1Ty(*TheContext), cond_ptr, "ifcond");
+                // Condition value (expect i1)
+                llvm::Value* cond = load_value(get_stored_in(mol.atoms[1]), llvm::Type::getInt1Ty(*session->context));
                 
-                llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
-                llvm::BasicBlock* ThenBB = llvm::BasicBlock::Create(*TheContext, "then", TheFunction);
+                llvm::Function* TheFunction = session->builder->GetInsertBlock()->getParent();
+                llvm::BasicBlock* ThenBB = llvm::BasicBlock::Create(*session->context, "then", TheFunction);
                 
                 bool has_else = (mol.atoms.size() == 4);
-                llvm::BasicBlock* ElseBB = has_else ? llvm::BasicBlock::Create(*TheContext, "else", TheFunction) : nullptr;
-                llvm::BasicBlock* MergeBB = llvm::BasicBlock::Create(*TheContext, "ifcont", TheFunction);
+                llvm::BasicBlock* ElseBB = has_else ? llvm::BasicBlock::Create(*session->context, "else", TheFunction) : nullptr;
+                llvm::BasicBlock* MergeBB = llvm::BasicBlock::Create(*session->context, "ifcont", TheFunction);
                 
-                Builder->CreateCondBr(cond, ThenBB, has_else ? ElseBB : MergeBB);
+                session->builder->CreateCondBr(cond, ThenBB, has_else ? ElseBB : MergeBB);
                 
                 // Then
-                Builder->SetInsertPoint(ThenBB);
+                session->builder->SetInsertPoint(ThenBB);
                 compile(mol.atoms[2]);
-                if (!Builder->GetInsertBlock()->getTerminator()) {
-                    Builder->CreateBr(MergeBB);
+                if (!session->builder->GetInsertBlock()->getTerminator()) {
+                    session->builder->CreateBr(MergeBB);
                 }
-                ThenBB = Builder->GetInsertBlock();
+                ThenBB = session->builder->GetInsertBlock();
                 
                 // Else
                 if (has_else) {
-                    Builder->SetInsertPoint(ElseBB);
+                    session->builder->SetInsertPoint(ElseBB);
                     compile(mol.atoms[3]);
-                    if (!Builder->GetInsertBlock()->getTerminator()) {
-                        Builder->CreateBr(MergeBB);
+                    if (!session->builder->GetInsertBlock()->getTerminator()) {
+                        session->builder->CreateBr(MergeBB);
                     }
-                    ElseBB = Builder->GetInsertBlock();
+                    ElseBB = session->builder->GetInsertBlock();
                 }
                 
                 // Only keep MergeBB if it has predecessors
                 if (MergeBB->hasNPredecessorsOrMore(1)) {
-                    Builder->SetInsertPoint(MergeBB);
+                    session->builder->SetInsertPoint(MergeBB);
                 } else {
                     MergeBB->eraseFromParent();
                 }
                 return;
             } else if (subj == "while") {
-                llvm::Function* TheFunction = Builder->GetInsertBlock()->getParent();
-                llvm::BasicBlock* CondBB = llvm::BasicBlock::Create(*TheContext, "cond", TheFunction);
-                llvm::BasicBlock* LoopBB = llvm::BasicBlock::Create(*TheContext, "loop", TheFunction);
-                llvm::BasicBlock* MergeBB = llvm::BasicBlock::Create(*TheContext, "whilecont", TheFunction);
+                llvm::Function* TheFunction = session->builder->GetInsertBlock()->getParent();
+                llvm::BasicBlock* CondBB = llvm::BasicBlock::Create(*session->context, "cond", TheFunction);
+                llvm::BasicBlock* LoopBB = llvm::BasicBlock::Create(*session->context, "loop", TheFunction);
+                llvm::BasicBlock* MergeBB = llvm::BasicBlock::Create(*session->context, "whilecont", TheFunction);
                 
-                Builder->CreateBr(CondBB);
+                session->builder->CreateBr(CondBB);
                 
                 // Condition
-                Builder->SetInsertPoint(CondBB);
+                session->builder->SetInsertPoint(CondBB);
                 compile(mol.atoms[1]);
-                llvm::Value* cond_ptr = get_stored_in(mol.atoms[1]);
-                llvm::Value* cond = Builder->CreateLoad(llvm::Type::getInt1Ty(*TheContext), cond_ptr, "whilecond");
-                Builder->CreateCondBr(cond, LoopBB, MergeBB);
+                llvm::Value* cond = load_value(get_stored_in(mol.atoms[1]), llvm::Type::getInt1Ty(*session->context));
+                session->builder->CreateCondBr(cond, LoopBB, MergeBB);
                 
                 // Body
-                Builder->SetInsertPoint(LoopBB);
+                session->builder->SetInsertPoint(LoopBB);
                 compile(mol.atoms[2]);
-                if (!Builder->GetInsertBlock()->getTerminator()) {
-                    Builder->CreateBr(CondBB);
+                if (!session->builder->GetInsertBlock()->getTerminator()) {
+                    session->builder->CreateBr(CondBB);
                 }
                 
-                Builder->SetInsertPoint(MergeBB);
+                session->builder->SetInsertPoint(MergeBB);
                 return;
             } else if (subj == "web-loop") {
                 // (web-loop fps { body })
@@ -361,43 +434,44 @@ void compile(Particle& p) {
                 
                 // Get FPS value
                 compile(mol.atoms[1]);
-                llvm::Value* fps_ptr = get_stored_in(mol.atoms[1]);
-                llvm::Value* fps_val = Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), fps_ptr, "fps");
+                llvm::Value* fps_val = load_value(get_stored_in(mol.atoms[1]), llvm::Type::getInt32Ty(*session->context));
                 
                 // Save current insert point
-                llvm::Function* MainFunc = Builder->GetInsertBlock()->getParent();
-                llvm::BasicBlock* ReturnPoint = Builder->GetInsertBlock();
+                llvm::Function* MainFunc = session->builder->GetInsertBlock()->getParent();
+                llvm::BasicBlock* ReturnPoint = session->builder->GetInsertBlock();
                 
                 // Create the UpdateFrame function (void -> void)
-                llvm::FunctionType* UpdateFT = llvm::FunctionType::get(llvm::Type::getVoidTy(*TheContext), false);
-                llvm::Function* UpdateFunc = llvm::Function::Create(UpdateFT, llvm::Function::ExternalLinkage, "UpdateFrame", TheModule.get());
-                llvm::BasicBlock* UpdateBB = llvm::BasicBlock::Create(*TheContext, "entry", UpdateFunc);
-                Builder->SetInsertPoint(UpdateBB);
+                llvm::FunctionType* UpdateFT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), false);
+                llvm::Function* UpdateFunc = llvm::Function::Create(UpdateFT, llvm::Function::ExternalLinkage, "UpdateFrame", session->module.get());
+                llvm::BasicBlock* UpdateBB = llvm::BasicBlock::Create(*session->context, "entry", UpdateFunc);
+                session->builder->SetInsertPoint(UpdateBB);
                 
                 // Compile the loop body inside UpdateFrame
                 compile(mol.atoms[2]);
                 
                 // Return void from UpdateFrame
-                if (!Builder->GetInsertBlock()->getTerminator()) {
-                    Builder->CreateRetVoid();
+                if (!session->builder->GetInsertBlock()->getTerminator()) {
+                    session->builder->CreateRetVoid();
                 }
+                // main never returns under emscripten's loop, so each frame writes out what it printed
+                flush_output_before_returns(UpdateFunc);
                 
                 // Back to main - call emscripten_set_main_loop
-                Builder->SetInsertPoint(ReturnPoint);
+                session->builder->SetInsertPoint(ReturnPoint);
                 
                 // Declare emscripten_set_main_loop(void (*func)(void), int fps, int simulate_infinite_loop)
                 std::vector<llvm::Type*> loop_args = {
-                    llvm::PointerType::getUnqual(*TheContext),  // function pointer
-                    llvm::Type::getInt32Ty(*TheContext),         // fps
-                    llvm::Type::getInt32Ty(*TheContext)          // simulate_infinite_loop
+                    llvm::PointerType::getUnqual(*session->context),  // function pointer
+                    llvm::Type::getInt32Ty(*session->context),         // fps
+                    llvm::Type::getInt32Ty(*session->context)          // simulate_infinite_loop
                 };
-                llvm::FunctionType* LoopFT = llvm::FunctionType::get(llvm::Type::getVoidTy(*TheContext), loop_args, false);
-                llvm::FunctionCallee SetMainLoop = TheModule->getOrInsertFunction("emscripten_set_main_loop", LoopFT);
+                llvm::FunctionType* LoopFT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), loop_args, false);
+                llvm::FunctionCallee SetMainLoop = session->module->getOrInsertFunction("emscripten_set_main_loop", LoopFT);
                 
-                Builder->CreateCall(SetMainLoop, {
+                session->builder->CreateCall(SetMainLoop, {
                     UpdateFunc,
                     fps_val,
-                    llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1)  // simulate_infinite_loop = 1
+                    llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1)  // simulate_infinite_loop = 1
                 });
                 
                 return;
@@ -407,40 +481,41 @@ void compile(Particle& p) {
                 // mol.atoms[2] is the body block
                 
                 Molecule& sig = std::get<Molecule>(mol.atoms[1]);
-                std::string return_type = sig.type;
+                TypeRef return_type = sig.type ? sig.type : VAR_TYPE;
                 std::string func_name = std::get<Atom>(sig.atoms[0]).identifier;
                 
                 // Collect parameter types and names
                 std::vector<std::string> param_names;
-                std::vector<std::string> param_types;
+                std::vector<TypeRef> param_types;
                 std::vector<llvm::Type*> llvm_param_types;
                 
                 for (size_t i = 1; i < sig.atoms.size(); i++) {
                     Atom& param = std::get<Atom>(sig.atoms[i]);
+                    TypeRef param_type = param.type ? param.type : VAR_TYPE;
                     param_names.push_back(param.identifier);
-                    param_types.push_back(param.type);
-                    llvm_param_types.push_back(get_llvm_type(param.type));
+                    param_types.push_back(param_type);
+                    llvm_param_types.push_back(get_llvm_type(param_type));
                 }
                 
                 // Create function type and function
                 llvm::Type* llvm_ret_type = get_llvm_type(return_type);
                 llvm::FunctionType* FT = llvm::FunctionType::get(llvm_ret_type, llvm_param_types, false);
-                llvm::Function* Func = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, func_name, TheModule.get());
+                llvm::Function* Func = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, func_name, session->module.get());
                 
-                // Save current state
-                llvm::BasicBlock* SavedBB = Builder->GetInsertBlock();
-                auto saved_registry = object_registry;
+                // Save current state; the fun's params and locals get their own scope
+                llvm::BasicBlock* SavedBB = session->builder->GetInsertBlock();
+                session->object_registry.push_scope();
                 
                 // Create entry block
-                llvm::BasicBlock* EntryBB = llvm::BasicBlock::Create(*TheContext, "entry", Func);
-                Builder->SetInsertPoint(EntryBB);
+                llvm::BasicBlock* EntryBB = llvm::BasicBlock::Create(*session->context, "entry", Func);
+                session->builder->SetInsertPoint(EntryBB);
                 
                 // Allocate parameters and add to registry
                 size_t idx = 0;
                 for (auto& Arg : Func->args()) {
-                    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_param_types[idx], nullptr, param_names[idx]);
-                    Builder->CreateStore(&Arg, alloca);
-                    object_registry[param_names[idx]] = MemObject(param_types[idx], alloca);
+                    llvm::AllocaInst* alloca = create_entry_alloca(llvm_param_types[idx], param_names[idx]);
+                    session->builder->CreateStore(&Arg, alloca);
+                    session->object_registry.define(param_names[idx], MemObject(param_types[idx], alloca));
                     idx++;
                 }
                 
@@ -451,214 +526,53 @@ void compile(Particle& p) {
                 }
                 
                 // Add implicit return if block doesn't have a terminator
-                if (!Builder->GetInsertBlock()->getTerminator()) {
+                if (!session->builder->GetInsertBlock()->getTerminator()) {
                     if (llvm_ret_type->isVoidTy()) {
-                        Builder->CreateRetVoid();
+                        session->builder->CreateRetVoid();
                     } else {
                         // Return a default value (zero) - should probably be an error
-                        Builder->CreateRet(llvm::Constant::getNullValue(llvm_ret_type));
+                        session->builder->CreateRet(llvm::Constant::getNullValue(llvm_ret_type));
                     }
                 }
                 
-                // Restore state
-                object_registry = saved_registry;
-                Builder->SetInsertPoint(SavedBB);
-                
-                // Register function as intrinsic for calling
-                std::string fn_return_type = return_type;
-                Function fn(func_name, 
-                    [Func, llvm_param_types, llvm_ret_type](Molecule& call_mol, const std::vector<llvm::Value*>& args) -> IntrinsicResult {
-                        std::vector<llvm::Value*> call_args;
-                        for (size_t i = 0; i < args.size(); i++) {
-                            llvm::Value* loaded = Builder->CreateLoad(llvm_param_types[i], args[i]);
-                            call_args.push_back(loaded);
-                        }
-                        llvm::Value* result = Builder->CreateCall(Func, call_args);
-                        if (llvm_ret_type->isVoidTy()) {
-                            return {nullptr};
-                        }
-                        llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_ret_type);
-                        Builder->CreateStore(result, alloca);
-                        return {alloca};
-                    },
-                    [fn_return_type](const std::vector<Particle>&) { return fn_return_type; }
-                );
-                fn.param_types = param_types;  // Store for overload matching
-                INTRINSICS[func_name] = fn;
-                return;
-            } else if (subj == "overload") {
-                // (overload + method) or (overload + [m1 m2 m3])
-                std::string op_name = std::get<Atom>(mol.atoms[1]).identifier;
-                
-                if (std::holds_alternative<Atom>(mol.atoms[2])) {
-                    // Single method
-                    std::string method = std::get<Atom>(mol.atoms[2]).identifier;
-                    overload_registry[op_name].push_back(method);
+                // Restore state (modules compile their funs with no enclosing function)
+                clear_temporaries();
+                session->object_registry.pop_scope();
+                if (SavedBB) {
+                    session->builder->SetInsertPoint(SavedBB);
                 } else {
-                    // Array of methods
-                    Molecule& methods = std::get<Molecule>(mol.atoms[2]);
-                    for (size_t i = 1; i < methods.atoms.size(); i++) {
-                        std::string method = std::get<Atom>(methods.atoms[i]).identifier;
-                        overload_registry[op_name].push_back(method);
-                    }
+                    session->builder->ClearInsertionPoint();
                 }
                 return;
-            } else if (subj == "extern") {
-                // (extern RetType:(FuncName ParamType:name ...))
-                // Declares an external C function
-                
-                Molecule& sig = std::get<Molecule>(mol.atoms[1]);
-                std::string return_type = sig.type;
-                std::string func_name = std::get<Atom>(sig.atoms[0]).identifier;
-                
-                // Collect parameter types
-                std::vector<std::string> param_types;
-                std::vector<llvm::Type*> llvm_param_types;
-                
-                for (size_t i = 1; i < sig.atoms.size(); i++) {
-                    Atom& param = std::get<Atom>(sig.atoms[i]);
-                    param_types.push_back(param.type);
-                    // For Str params passed to C, use ptr (char*)
-                    if (param.type == "Str") {
-                        llvm_param_types.push_back(llvm::PointerType::getUnqual(*TheContext));
-                    } else if (struct_registry.count(param.type) && struct_registry[param.type].is_extern) {
-                        // Extern structs on x86_64: small structs (<=8 bytes) passed as integers
-                        // For a 4-byte struct like Color, C ABI uses i32
-                        StructDef& sdef = struct_registry[param.type];
-                        // Calculate actual size based on field types
-                        size_t byte_size = 0;
-                        for (const auto& ft : sdef.field_types) {
-                            if (ft == "Char") byte_size += 1;
-                            else if (ft == "Int") byte_size += 4;
-                            else if (ft == "Float") byte_size += 4;
-                            else if (ft == "Bool") byte_size += 1;
-                            else byte_size += 8; // pointer types
-                        }
-                        if (byte_size <= 4) {
-                            llvm_param_types.push_back(llvm::Type::getInt32Ty(*TheContext));
-                        } else if (byte_size <= 8) {
-                            llvm_param_types.push_back(llvm::Type::getInt64Ty(*TheContext));
-                        } else {
-                            // Larger structs passed by pointer
-                            llvm_param_types.push_back(llvm::PointerType::getUnqual(*TheContext));
-                        }
-                    } else {
-                        llvm_param_types.push_back(get_llvm_type(param.type));
-                    }
-                }
-                
-                // Create function type and declare external function
-                llvm::Type* llvm_ret_type = get_llvm_type(return_type);
-                llvm::FunctionType* FT = llvm::FunctionType::get(llvm_ret_type, llvm_param_types, false);
-                llvm::FunctionCallee extern_func = TheModule->getOrInsertFunction(func_name, FT);
-                
-                // Register as intrinsic for calling
-                std::string fn_return_type = return_type;
-                std::vector<std::string> captured_param_types = param_types;
-                Function fn(func_name, 
-                    [extern_func, captured_param_types, llvm_ret_type](Molecule& call_mol, const std::vector<llvm::Value*>& args) -> IntrinsicResult {
-                        (void)call_mol; // unused
-                        std::vector<llvm::Value*> call_args;
-                        for (size_t i = 0; i < args.size(); i++) {
-                            if (captured_param_types[i] == "Str") {
-                                // Extract char* from Str struct
-                                call_args.push_back(extract_cstring(args[i]));
-                            } else if (struct_registry.count(captured_param_types[i]) && 
-                                       struct_registry[captured_param_types[i]].is_extern) {
-                                // Coerce extern struct to integer for C ABI
-                                StructDef& sdef = struct_registry[captured_param_types[i]];
-                                size_t byte_size = 0;
-                                for (const auto& ft : sdef.field_types) {
-                                    if (ft == "Char") byte_size += 1;
-                                    else if (ft == "Int") byte_size += 4;
-                                    else if (ft == "Float") byte_size += 4;
-                                    else if (ft == "Bool") byte_size += 1;
-                                    else byte_size += 8;
-                                }
-                                if (byte_size <= 4) {
-                                    // Bitcast struct pointer to i32 pointer, then load
-                                    llvm::Value* loaded = Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), args[i]);
-                                    call_args.push_back(loaded);
-                                } else if (byte_size <= 8) {
-                                    llvm::Value* loaded = Builder->CreateLoad(llvm::Type::getInt64Ty(*TheContext), args[i]);
-                                    call_args.push_back(loaded);
-                                } else {
-                                    // Pass pointer for large structs
-                                    call_args.push_back(args[i]);
-                                }
-                            } else {
-                                // Load primitive value
-                                llvm::Type* arg_type = get_llvm_type(captured_param_types[i]);
-                                llvm::Value* loaded = Builder->CreateLoad(arg_type, args[i]);
-                                call_args.push_back(loaded);
-                            }
-                        }
-                        llvm::Value* result = Builder->CreateCall(extern_func, call_args);
-                        if (llvm_ret_type->isVoidTy()) {
-                            return {nullptr};
-                        }
-                        llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_ret_type);
-                        Builder->CreateStore(result, alloca);
-                        return {alloca};
-                    },
-                    [fn_return_type](const std::vector<Particle>&) { return fn_return_type; }
-                );
-                fn.param_types = param_types;
-                INTRINSICS[func_name] = fn;
+            } else if (subj == "declare" || subj == "extern" || subj == "overload") {
+                // Registered by the type pass (register_signature, register_overload); calls declare what they use
                 return;
             } else if (subj == "struct") {
                 // (struct Person:[Str:name Int:age Bool:friend])
                 // mol.atoms[1] is typed array molecule with struct name as type
                 Molecule& fields_mol = std::get<Molecule>(mol.atoms[1]);
-                std::string struct_name = fields_mol.type;
+                std::string struct_name = fields_mol.type ? fields_mol.type->name.str() : "";
                 
                 // Skip if already registered by collect_struct_declarations
-                if (struct_registry.count(struct_name)) {
+                if (session->struct_registry.count(struct_name)) {
                     return;
                 }
                 
-                StructDef def;
-                def.name = struct_name;
-                
-                std::vector<llvm::Type*> llvm_field_types;
-                for (size_t i = 1; i < fields_mol.atoms.size(); i++) {
-                    Atom& field = std::get<Atom>(fields_mol.atoms[i]);
-                    def.field_names.push_back(field.identifier);
-                    def.field_types.push_back(field.type);
-                    llvm_field_types.push_back(get_llvm_type(field.type));
-                }
-                
-                def.llvm_type = llvm::StructType::create(*TheContext, llvm_field_types, struct_name);
-                struct_registry[struct_name] = def;
+                declare_struct(struct_name, fields_mol, false);
                 return;
             } else if (subj == "extern-struct") {
                 // (extern-struct Color [Char:r Char:g Char:b Char:a])
                 // Skip if already registered by collect_struct_declarations
                 std::string struct_name = std::get<Atom>(mol.atoms[1]).identifier;
-                if (struct_registry.count(struct_name)) {
+                if (session->struct_registry.count(struct_name)) {
                     return;  // Already registered
                 }
                 
-                Molecule& fields_mol = std::get<Molecule>(mol.atoms[2]);
-                
-                StructDef def;
-                def.name = struct_name;
-                def.is_extern = true;
-                
-                std::vector<llvm::Type*> llvm_field_types;
-                for (size_t i = 1; i < fields_mol.atoms.size(); i++) {
-                    Atom& field = std::get<Atom>(fields_mol.atoms[i]);
-                    def.field_names.push_back(field.identifier);
-                    def.field_types.push_back(field.type);
-                    llvm_field_types.push_back(get_llvm_type(field.type));
-                }
-                
-                def.llvm_type = llvm::StructType::create(*TheContext, llvm_field_types, struct_name);
-                struct_registry[struct_name] = def;
+                declare_struct(struct_name, std::get<Molecule>(mol.atoms[2]), true);
                 return;
-            } else if (subj == "array" && struct_registry.count(mol.type)) {
+            } else if (subj == "array" && is_struct_type(mol.type)) {
                 // Struct literal: Person:["bob" 67 true]
-                StructDef& def = struct_registry[mol.type];
+                StructDef& def = *mol.type->struct_def();
                 
                 // Compile all field values first
                 for (size_t i = 1; i < mol.atoms.size(); i++) {
@@ -666,34 +580,53 @@ void compile(Particle& p) {
                 }
                 
                 // Allocate struct
-                llvm::AllocaInst* struct_alloc = Builder->CreateAlloca(def.llvm_type, nullptr, "struct_instance");
+                llvm::Value* struct_alloc = create_temporary(def.llvm_type, "struct_instance");
                 
-                // Store each field
+                std::vector<llvm::Value*> values;
                 for (size_t i = 1; i < mol.atoms.size(); i++) {
-                    llvm::Value* val_ptr = get_stored_in(mol.atoms[i]);
-                    llvm::Type* field_llvm_type = get_llvm_type(def.field_types[i-1]);
-                    llvm::Value* val = Builder->CreateLoad(field_llvm_type, val_ptr);
-                    llvm::Value* field_ptr = Builder->CreateStructGEP(def.llvm_type, struct_alloc, i-1);
-                    Builder->CreateStore(val, field_ptr);
+                    TypeRef field_type = def.field_types[i-1];
+                    values.push_back(copy_stored_value(field_type, load_value(get_stored_in(mol.atoms[i]), get_llvm_type(field_type))));
+                }
+                
+                // Store each field, or copy them all at once when they are constants
+                if (!copy_constant_literal(struct_alloc, def.llvm_type, values)) {
+                    for (size_t i = 0; i < values.size(); i++) {
+                        llvm::Value* field_ptr = session->builder->CreateStructGEP(def.llvm_type, struct_alloc, i);
+                        session->builder->CreateStore(values[i], field_ptr);
+                    }
                 }
                 
                 if (def.is_extern) {
-                    // For extern structs, just store the alloca directly (pass by value later)
-                    mol.stored_in = struct_alloc;
+                    // For extern structs, the struct's memory itself is the value (pass by value later)
+                    mol.stored_in = StoredValue::address(struct_alloc);
                 } else {
-                    // For internal structs, return pointer to struct (pointer-to-pointer pattern)
-                    llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "struct_ref");
-                    Builder->CreateStore(struct_alloc, result_ptr);
-                    mol.stored_in = result_ptr;
+                    // For internal structs, the value is the pointer to the struct
+                    mol.stored_in = StoredValue::rvalue(struct_alloc);
                 }
                 return;
             } else if (subj == "array") {
                 
+            } else if (subj == "meowf") {
+                // String literals are written out as they are, so only the other arguments are compiled
+                for (size_t i = 1; i < mol.atoms.size(); i++) {
+                    auto& child = mol.atoms[i];
+                    bool literal = std::holds_alternative<Atom>(child) && std::get<Atom>(child).quoted;
+                    if (!literal && !get_stored_in(child)) {
+                        compile(child);
+                    }
+                }
+                evaluate(mol);
+                return;
             }
         }
 
+        // String literals that the callee only reads can stay in read-only memory
+        bool borrows = mol.callee && mol.callee->borrows_args;
         for (size_t i = 1; i < mol.atoms.size(); i++) {
             auto& child = mol.atoms[i];
+            if (borrows && std::holds_alternative<Atom>(child) && std::get<Atom>(child).quoted) {
+                std::get<Atom>(child).borrowed = true;
+            }
             if (!get_stored_in(child)) {
                 compile(child);
             }
@@ -707,3 +640,93 @@ void compile(Particle& p) {
     }
 }
 
+// Forms allowed at the top of a module: everything that declares, nothing that runs
+static bool is_module_form(const Particle& p) {
+    if (!std::holds_alternative<Molecule>(p)) return false;
+    const Molecule& mol = std::get<Molecule>(p);
+    if (mol.atoms.empty() || !std::holds_alternative<Atom>(mol.subject())) return false;
+    const std::string& subj = std::get<Atom>(mol.subject()).identifier;
+    return subj == "fun" || subj == "declare" || subj == "extern" || subj == "overload" ||
+           subj == "struct" || subj == "extern-struct";
+}
+
+bool compile_module(Molecule& root) {
+    bool ok = true;
+    for (size_t i = 1; i < root.atoms.size(); i++) {
+        if (!is_module_form(root.atoms[i])) {
+            const Particle& p = root.atoms[i];
+            int line = std::holds_alternative<Atom>(p) ? std::get<Atom>(p).line : std::get<Molecule>(p).line;
+            int col = std::holds_alternative<Atom>(p) ? std::get<Atom>(p).col : std::get<Molecule>(p).col;
+            std::cerr << "Error: " << session->line_map.locate(line) << ":" << col
+                      << ": only fun, declare, extern, overload and struct forms can be at the top of a module" << std::endl;
+            ok = false;
+        }
+    }
+    if (!ok) return false;
+
+    // No main: each fun is compiled on its own, with nothing to return to
+    session->builder->ClearInsertionPoint();
+    for (size_t i = 1; i < root.atoms.size(); i++) {
+        compile(root.atoms[i]);
+    }
+    return true;
+}
+
+static std::string typed_name(const std::string& name, TypeRef type) {
+    return type ? type->name.str() + ":" + name : name;
+}
+
+static std::string struct_fields(const StructDef& def) {
+    std::string fields = "[";
+    for (size_t i = 0; i < def.field_names.size(); i++) {
+        if (i > 0) fields += " ";
+        fields += typed_name(def.field_names[i], def.field_types[i]);
+    }
+    return fields + "]";
+}
+
+std::string module_interface(const Molecule& root, const std::string& module_name) {
+    std::string out = "; interface of " + module_name + ", written by miaow --module\n{\n";
+    for (size_t i = 1; i < root.atoms.size(); i++) {
+        const Molecule& mol = std::get<Molecule>(root.atoms[i]);
+        const std::string& subj = std::get<Atom>(mol.subject()).identifier;
+
+        if (subj == "fun") {
+            const Molecule& sig = std::get<Molecule>(mol.atoms[1]);
+            std::string decl = "(" + std::get<Atom>(sig.atoms[0]).identifier.str();
+            for (size_t j = 1; j < sig.atoms.size(); j++) {
+                const Atom& param = std::get<Atom>(sig.atoms[j]);
+                decl += " " + typed_name(param.identifier, param.type);
+            }
+            decl += ")";
+            out += "    (declare " + (sig.type ? sig.type->name.str() + ":" + decl : decl) + ")\n";
+        } else if (subj == "struct" || subj == "extern-struct") {
+            // Written from the registry, so both struct syntaxes come out the same
+            const std::string& name = std::holds_alternative<Atom>(mol.atoms[1])
+                ? std::get<Atom>(mol.atoms[1]).identifier.str()
+                : std::get<Molecule>(mol.atoms[1]).type->name.str();
+            const StructDef& def = session->struct_registry.at(name);
+            if (def.is_extern) {
+                out += "    (extern-struct " + name + " " + struct_fields(def) + ")\n";
+            } else {
+                out += "    (struct " + name + ":" + struct_fields(def) + ")\n";
+            }
+        } else if (subj == "overload") {
+            std::string methods;
+            if (std::holds_alternative<Atom>(mol.atoms[2])) {
+                methods = std::get<Atom>(mol.atoms[2]).identifier.str();
+            } else {
+                const Molecule& list = std::get<Molecule>(mol.atoms[2]);
+                methods = "[";
+                for (size_t j = 1; j < list.atoms.size(); j++) {
+                    if (j > 1) methods += " ";
+                    methods += std::get<Atom>(list.atoms[j]).identifier.str();
+                }
+                methods += "]";
+            }
+            out += "    (overload " + std::get<Atom>(mol.atoms[1]).identifier.str() + " " + methods + ")\n";
+        }
+        // extern and declare forms are what the module uses, not what it defines
+    }
+    return out + "}\n";
+}
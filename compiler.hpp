@@ -9,15 +9,28 @@
 // Target flag (defined in miaow.cpp)
 extern bool target_wasm;
 
-llvm::Value* evaluate(Atom& atom);
+StoredValue evaluate(Atom& atom);
 
-llvm::Value* evaluate(Molecule& mol);
+StoredValue evaluate(Molecule& mol);
 
 void collect_struct_declarations(Particle& p);
 
-void collect_variables(Particle& p, std::unordered_map<std::string, std::string>& vars);
-
 void compile(Particle& p);
 
+// Make the fun, declare or extern form mol callable by name: registers a Function for its signature.
+// The type pass does this as it reaches the form, so it can resolve the calls that follow.
+Function* register_signature(Molecule& mol);
+
+// Make method one of the overloads of op_name, found by its parameter types
+void register_overload(const std::string& op_name, Function* method);
+
+// Compile a module (--module): its funs, structs and overloads, without a main.
+// Prints an error and returns false for anything at the top level that would need to run.
+bool compile_module(Molecule& root);
+
+// The interface file of a compiled module: a struct, declare or overload form for everything
+// it defines, so importers can type check and call into it while linking the module's object
+std::string module_interface(const Molecule& root, const std::string& module_name);
+
 
 #endif // COMPILER_HPP
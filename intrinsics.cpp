@@ -1,28 +1,88 @@
 #include "intrinsics.hpp"
+#include "session.hpp"
+#include "runtime.hpp"
+
+Function* resolve_call(Molecule& mol, const std::vector<TypeRef>& arg_types) {
+    if (mol.callee) return mol.callee;
+    if (mol.atoms.empty() || !std::holds_alternative<Atom>(mol.subject())) return nullptr;
+    const std::string& fn_name = std::get<Atom>(mol.subject()).identifier;
+
+    auto overloads = session->overload_registry.find(fn_name);
+    if (overloads != session->overload_registry.end()) {
+        auto method = overloads->second.find(arg_types);
+        if (method != overloads->second.end()) {
+            mol.callee = method->second;
+            return mol.callee;
+        }
+    }
 
-std::unordered_map<std::string, Function> INTRINSICS;
-
-IntrinsicResult Function::evaluate(Molecule& mol, const std::vector<llvm::Value*>& args) {
-    return build(mol, args);
+    auto fn = session->intrinsics.find(fn_name);
+    if (fn != session->intrinsics.end()) mol.callee = &fn->second;
+    return mol.callee;
 }
 
-llvm::Value* load_value(llvm::Value* v, llvm::Type* type) {
-    return Builder->CreateLoad(type, v);
+Function* resolve_call(Molecule& mol) {
+    if (mol.callee) return mol.callee;
+    std::vector<TypeRef> arg_types;
+    for (size_t i = 1; i < mol.atoms.size(); i++) {
+        arg_types.push_back(get_particle_type(mol.atoms[i]));
+    }
+    return resolve_call(mol, arg_types);
 }
 
-static std::string get_array_element_type_str(const std::string& array_type_str) {
-    // Expect: Array<T> or Str (which is Array<Char>)
-    if (array_type_str == "Str") {
-        return "Char";
+IntrinsicResult Function::evaluate(Molecule& mol, const std::vector<StoredValue>& args) {
+    IntrinsicResult result = build(mol, args);
+    if (borrows_args) {
+        for (const StoredValue& arg : args) {
+            release_temporary(arg);
+        }
     }
-    if (array_type_str.size() >= 7 && array_type_str.rfind("Array<", 0) == 0 && array_type_str.back() == '>') {
-        return array_type_str.substr(6, array_type_str.size() - 7);
+    return result;
+}
+
+llvm::Value* load_value(const StoredValue& v, llvm::Type* type) {
+    if (v.is_address) return session->builder->CreateLoad(type, v.value);
+    // Int literals used as Char/Bool (e.g. (append s 33)) used to be reloaded
+    // from their i32 spill slot at the narrower type; truncate to match
+    llvm::Type* value_type = v.value->getType();
+    if (value_type != type && value_type->isIntegerTy() && type->isIntegerTy()) {
+        return session->builder->CreateZExtOrTrunc(v.value, type);
     }
-    return "Var";
+    return v.value;
+}
+
+llvm::Value* copy_stored_value(TypeRef type, llvm::Value* value) {
+    bool sequence = type && (type->kind == TypeKind::Str || type->kind == TypeKind::Array);
+    bool internal_struct = is_struct_type(type) && !type->struct_def()->is_extern;
+    if (!sequence && !internal_struct) return value;
+
+    llvm::Type* i32_type = llvm::Type::getInt32Ty(*session->context);
+    llvm::Type* i64_type = llvm::Type::getInt64Ty(*session->context);
+    llvm::Type* ptr_type = llvm::PointerType::getUnqual(*session->context);
+    llvm::FunctionCallee malloc_func = session->module->getOrInsertFunction("malloc", llvm::FunctionType::get(ptr_type, {i64_type}, false));
+
+    llvm::Type* header_type = internal_struct ? static_cast<llvm::Type*>(type->struct_def()->llvm_type) : get_array_struct_type(type);
+    llvm::Constant* header_size = llvm::ConstantExpr::getSizeOf(header_type);
+    llvm::Value* copy = session->builder->CreateCall(malloc_func, {header_size}, "copy");
+    session->builder->CreateMemCpy(copy, llvm::MaybeAlign(), value, llvm::MaybeAlign(), header_size);
+    if (internal_struct) return copy;
+
+    // The data too, exactly as much as is used (and a Str's NUL); capacity 0 if that is nothing
+    llvm::StructType* array_struct_type = get_array_struct_type(type);
+    llvm::Type* element_type = get_llvm_type(array_element_type(type));
+    llvm::Value* size = session->builder->CreateLoad(i32_type, session->builder->CreateStructGEP(array_struct_type, copy, 0), "size");
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(array_struct_type, copy, 2, "data_ptr_ptr");
+    llvm::Value* count = type == STR_TYPE ? session->builder->CreateAdd(size, llvm::ConstantInt::get(i32_type, 1)) : size;
+    llvm::Value* bytes = session->builder->CreateMul(session->builder->CreateZExt(count, i64_type), llvm::ConstantExpr::getSizeOf(element_type));
+    llvm::Value* new_data = session->builder->CreateCall(malloc_func, {bytes}, "copy_data");
+    session->builder->CreateMemCpy(new_data, llvm::MaybeAlign(), session->builder->CreateLoad(ptr_type, data_ptr_ptr, "data_ptr"), llvm::MaybeAlign(), bytes);
+    session->builder->CreateStore(count, session->builder->CreateStructGEP(array_struct_type, copy, 1, "cap_ptr"));
+    session->builder->CreateStore(new_data, data_ptr_ptr);
+    return copy;
 }
 
-IntrinsicResult build_arith(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& fn_name) {
-    std::string particle_type = get_particle_type(mol.atoms[1]);
+IntrinsicResult build_arith(Molecule& mol, const std::vector<StoredValue>& args, const std::string& fn_name) {
+    TypeRef particle_type = get_particle_type(mol.atoms[1]);
     llvm::Type* llvm_type = get_llvm_type(particle_type);
     
     llvm::Value* lhs = load_value(args[0], llvm_type);
@@ -30,28 +90,25 @@ IntrinsicResult build_arith(Molecule& mol, const std::vector<llvm::Value*>& args
     
     llvm::Value* result = nullptr;
     
-    if (particle_type == "Int") {
-        if (fn_name == "+") result = Builder->CreateAdd(lhs, rhs);
-        else if (fn_name == "-") result = Builder->CreateSub(lhs, rhs);
-        else if (fn_name == "*") result = Builder->CreateMul(lhs, rhs);
-        else if (fn_name == "/") result = Builder->CreateSDiv(lhs, rhs);
-        else if (fn_name == "%") result = Builder->CreateSRem(lhs, rhs);
-    } else if (particle_type == "Float") {
-        if (fn_name == "+") result = Builder->CreateFAdd(lhs, rhs);
-        else if (fn_name == "-") result = Builder->CreateFSub(lhs, rhs);
-        else if (fn_name == "*") result = Builder->CreateFMul(lhs, rhs);
-        else if (fn_name == "/") result = Builder->CreateFDiv(lhs, rhs);
-        else if (fn_name == "%") result = Builder->CreateFRem(lhs, rhs);
+    if (particle_type == INT_TYPE) {
+        if (fn_name == "+") result = session->builder->CreateAdd(lhs, rhs);
+        else if (fn_name == "-") result = session->builder->CreateSub(lhs, rhs);
+        else if (fn_name == "*") result = session->builder->CreateMul(lhs, rhs);
+        else if (fn_name == "/") result = session->builder->CreateSDiv(lhs, rhs);
+        else if (fn_name == "%") result = session->builder->CreateSRem(lhs, rhs);
+    } else if (particle_type == FLOAT_TYPE) {
+        if (fn_name == "+") result = session->builder->CreateFAdd(lhs, rhs);
+        else if (fn_name == "-") result = session->builder->CreateFSub(lhs, rhs);
+        else if (fn_name == "*") result = session->builder->CreateFMul(lhs, rhs);
+        else if (fn_name == "/") result = session->builder->CreateFDiv(lhs, rhs);
+        else if (fn_name == "%") result = session->builder->CreateFRem(lhs, rhs);
     }
     
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_type);
-    Builder->CreateStore(result, alloca);
-    
-    return {alloca};
+    return StoredValue::rvalue(result);
 }
 
-IntrinsicResult build_compound_arith(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& fn_name) {
-    std::string particle_type = get_particle_type(mol.atoms[1]);
+IntrinsicResult build_compound_arith(Molecule& mol, const std::vector<StoredValue>& args, const std::string& fn_name) {
+    TypeRef particle_type = get_particle_type(mol.atoms[1]);
     llvm::Type* llvm_type = get_llvm_type(particle_type);
     
     llvm::Value* result = nullptr;
@@ -59,40 +116,41 @@ IntrinsicResult build_compound_arith(Molecule& mol, const std::vector<llvm::Valu
         llvm::Value* arg = load_value(args[0], llvm_type);
         
         
-        if (particle_type == "Int") {
-            if (fn_name == "++") result = Builder->CreateAdd(arg, Builder->getInt32(1));
-            else if (fn_name == "--") result = Builder->CreateAdd(arg, Builder->getInt32(-1));
-        } else if (particle_type == "Float") {
-            if (fn_name == "++") result = Builder->CreateFAdd(arg, llvm::ConstantFP::get(Builder->getFloatTy(), 1.0));
-            else if (fn_name == "--") result = Builder->CreateFAdd(arg, llvm::ConstantFP::get(Builder->getFloatTy(), -1.0));
+        if (particle_type == INT_TYPE) {
+            if (fn_name == "++") result = session->builder->CreateAdd(arg, session->builder->getInt32(1));
+            else if (fn_name == "--") result = session->builder->CreateAdd(arg, session->builder->getInt32(-1));
+        } else if (particle_type == FLOAT_TYPE) {
+            if (fn_name == "++") result = session->builder->CreateFAdd(arg, llvm::ConstantFP::get(session->builder->getFloatTy(), 1.0));
+            else if (fn_name == "--") result = session->builder->CreateFAdd(arg, llvm::ConstantFP::get(session->builder->getFloatTy(), -1.0));
         }
     } else if (args.size() == 2) {
         llvm::Value* lhs = load_value(args[0], llvm_type);
         llvm::Value* rhs = load_value(args[1], llvm_type);
         
-        if (particle_type == "Int") {
-            if (fn_name == "+") result = Builder->CreateAdd(lhs, rhs);
-            else if (fn_name == "-") result = Builder->CreateSub(lhs, rhs);
-            else if (fn_name == "*") result = Builder->CreateMul(lhs, rhs);
-            else if (fn_name == "/") result = Builder->CreateSDiv(lhs, rhs);
-            else if (fn_name == "%") result = Builder->CreateSRem(lhs, rhs);
-        } else if (particle_type == "Float") {
-            if (fn_name == "+") result = Builder->CreateFAdd(lhs, rhs);
-            else if (fn_name == "-") result = Builder->CreateFSub(lhs, rhs);
-            else if (fn_name == "*") result = Builder->CreateFMul(lhs, rhs);
-            else if (fn_name == "/") result = Builder->CreateFDiv(lhs, rhs);
-            else if (fn_name == "%") result = Builder->CreateFRem(lhs, rhs);
+        if (particle_type == INT_TYPE) {
+            if (fn_name == "+") result = session->builder->CreateAdd(lhs, rhs);
+            else if (fn_name == "-") result = session->builder->CreateSub(lhs, rhs);
+            else if (fn_name == "*") result = session->builder->CreateMul(lhs, rhs);
+            else if (fn_name == "/") result = session->builder->CreateSDiv(lhs, rhs);
+            else if (fn_name == "%") result = session->builder->CreateSRem(lhs, rhs);
+        } else if (particle_type == FLOAT_TYPE) {
+            if (fn_name == "+") result = session->builder->CreateFAdd(lhs, rhs);
+            else if (fn_name == "-") result = session->builder->CreateFSub(lhs, rhs);
+            else if (fn_name == "*") result = session->builder->CreateFMul(lhs, rhs);
+            else if (fn_name == "/") result = session->builder->CreateFDiv(lhs, rhs);
+            else if (fn_name == "%") result = session->builder->CreateFRem(lhs, rhs);
         }
     }
         
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_type);
-    Builder->CreateStore(result, alloca);
-    Builder->CreateStore(result, args[0]);
-    return {alloca};
+    // Write back through the operand if it names storage (e.g. (++ x))
+    if (args[0].is_address) {
+        session->builder->CreateStore(result, args[0].value);
+    }
+    return StoredValue::rvalue(result);
 }
 
-IntrinsicResult build_compare(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& fn_name) {
-    std::string particle_type = get_particle_type(mol.atoms[1]);
+IntrinsicResult build_compare(Molecule& mol, const std::vector<StoredValue>& args, const std::string& fn_name) {
+    TypeRef particle_type = get_particle_type(mol.atoms[1]);
     llvm::Type* llvm_type = get_llvm_type(particle_type);
     
     llvm::Value* lhs = load_value(args[0], llvm_type);
@@ -100,65 +158,56 @@ IntrinsicResult build_compare(Molecule& mol, const std::vector<llvm::Value*>& ar
     
     llvm::Value* result = nullptr;
     
-    if (particle_type == "Int") {
-        if (fn_name == "==") result = Builder->CreateICmpEQ(lhs, rhs);
-        else if (fn_name == "!=") result = Builder->CreateICmpNE(lhs, rhs);
-        else if (fn_name == ">") result = Builder->CreateICmpSGT(lhs, rhs);
-        else if (fn_name == ">=") result = Builder->CreateICmpSGE(lhs, rhs);
-        else if (fn_name == "<") result = Builder->CreateICmpSLT(lhs, rhs);
-        else if (fn_name == "<=") result = Builder->CreateICmpSLE(lhs, rhs);
-    } else if (particle_type == "Float") {
-        if (fn_name == "==") result = Builder->CreateFCmpOEQ(lhs, rhs);
-        else if (fn_name == "!=") result = Builder->CreateFCmpONE(lhs, rhs);
-        else if (fn_name == ">") result = Builder->CreateFCmpOGT(lhs, rhs);
-        else if (fn_name == ">=") result = Builder->CreateFCmpOGE(lhs, rhs);
-        else if (fn_name == "<") result = Builder->CreateFCmpOLT(lhs, rhs);
-        else if (fn_name == "<=") result = Builder->CreateFCmpOLE(lhs, rhs);
+    if (particle_type == INT_TYPE) {
+        if (fn_name == "==") result = session->builder->CreateICmpEQ(lhs, rhs);
+        else if (fn_name == "!=") result = session->builder->CreateICmpNE(lhs, rhs);
+        else if (fn_name == ">") result = session->builder->CreateICmpSGT(lhs, rhs);
+        else if (fn_name == ">=") result = session->builder->CreateICmpSGE(lhs, rhs);
+        else if (fn_name == "<") result = session->builder->CreateICmpSLT(lhs, rhs);
+        else if (fn_name == "<=") result = session->builder->CreateICmpSLE(lhs, rhs);
+    } else if (particle_type == FLOAT_TYPE) {
+        if (fn_name == "==") result = session->builder->CreateFCmpOEQ(lhs, rhs);
+        else if (fn_name == "!=") result = session->builder->CreateFCmpONE(lhs, rhs);
+        else if (fn_name == ">") result = session->builder->CreateFCmpOGT(lhs, rhs);
+        else if (fn_name == ">=") result = session->builder->CreateFCmpOGE(lhs, rhs);
+        else if (fn_name == "<") result = session->builder->CreateFCmpOLT(lhs, rhs);
+        else if (fn_name == "<=") result = session->builder->CreateFCmpOLE(lhs, rhs);
     }
     
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm::Type::getInt1Ty(*TheContext));
-    Builder->CreateStore(result, alloca);
-    
-    return {alloca};
+    return StoredValue::rvalue(result);
 }
 
 // ! - boolean not operator
-IntrinsicResult build_not(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_not(Molecule& mol, const std::vector<StoredValue>& args) {
     (void)mol; // unused
-    llvm::Value* val = load_value(args[0], llvm::Type::getInt1Ty(*TheContext));
-    llvm::Value* result = Builder->CreateNot(val, "not");
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm::Type::getInt1Ty(*TheContext));
-    Builder->CreateStore(result, alloca);
-    return {alloca};
+    llvm::Value* val = load_value(args[0], llvm::Type::getInt1Ty(*session->context));
+    llvm::Value* result = session->builder->CreateNot(val, "not");
+    return StoredValue::rvalue(result);
 }
 
 // && - logical AND
-IntrinsicResult build_and(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_and(Molecule& mol, const std::vector<StoredValue>& args) {
     (void)mol;
-    llvm::Value* lhs = load_value(args[0], llvm::Type::getInt1Ty(*TheContext));
-    llvm::Value* rhs = load_value(args[1], llvm::Type::getInt1Ty(*TheContext));
-    llvm::Value* result = Builder->CreateAnd(lhs, rhs, "and");
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm::Type::getInt1Ty(*TheContext));
-    Builder->CreateStore(result, alloca);
-    return {alloca};
+    llvm::Value* lhs = load_value(args[0], llvm::Type::getInt1Ty(*session->context));
+    llvm::Value* rhs = load_value(args[1], llvm::Type::getInt1Ty(*session->context));
+    llvm::Value* result = session->builder->CreateAnd(lhs, rhs, "and");
+    return StoredValue::rvalue(result);
 }
 
 // || - logical OR
-IntrinsicResult build_or(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_or(Molecule& mol, const std::vector<StoredValue>& args) {
     (void)mol;
-    llvm::Value* lhs = load_value(args[0], llvm::Type::getInt1Ty(*TheContext));
-    llvm::Value* rhs = load_value(args[1], llvm::Type::getInt1Ty(*TheContext));
-    llvm::Value* result = Builder->CreateOr(lhs, rhs, "or");
-    llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm::Type::getInt1Ty(*TheContext));
-    Builder->CreateStore(result, alloca);
-    return {alloca};
+    llvm::Value* lhs = load_value(args[0], llvm::Type::getInt1Ty(*session->context));
+    llvm::Value* rhs = load_value(args[1], llvm::Type::getInt1Ty(*session->context));
+    llvm::Value* result = session->builder->CreateOr(lhs, rhs, "or");
+    return StoredValue::rvalue(result);
 }
 
 // def - declaration with REQUIRED type annotation, optional initial value
 IntrinsicResult build_def(Molecule& mol) {
     if (mol.atoms.size() >= 2) {
-        std::string var_name;
-        std::string explicit_type;
+        Symbol var_name;
+        TypeRef explicit_type = nullptr;
         
         if (std::holds_alternative<Atom>(mol.atoms[1])) {
             Atom& var_atom = std::get<Atom>(mol.atoms[1]);
@@ -167,56 +216,44 @@ IntrinsicResult build_def(Molecule& mol) {
         }
         
         // Type annotation is required for def
-        if (explicit_type.empty()) {
+        if (!explicit_type) {
             std::cerr << "Error: def requires type annotation (e.g., def Int:x or def Int:x 5)" << std::endl;
-            return {nullptr};
+            return {};
         }
         
-        // Check if this is an extern struct type
-        bool is_extern_struct = struct_registry.count(explicit_type) && struct_registry[explicit_type].is_extern;
+        llvm::Type* llvm_type = get_storage_type(explicit_type);
         
-        llvm::Type* llvm_type;
-        if (is_extern_struct) {
-            // For extern structs, allocate the actual struct type (not a pointer)
-            llvm_type = struct_registry[explicit_type].llvm_type;
-        } else {
-            llvm_type = get_llvm_type(explicit_type);
-        }
-        
-        // Use hoisted alloca if exists, otherwise create new one
+        // Redefining a variable of this scope with the same type reuses its storage (REPL
+        // globals are defined up front); otherwise it gets a new slot, shadowing the old one
         llvm::Value* var_ptr = nullptr;
-        if (object_registry.count(var_name) && object_registry[var_name].value != nullptr) {
-            var_ptr = object_registry[var_name].value;
+        MemObject* existing = session->object_registry.find_local(var_name);
+        if (existing && existing->value != nullptr && existing->type == explicit_type) {
+            var_ptr = existing->value;
         } else {
-            llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_type);
-            object_registry[var_name] = MemObject(explicit_type, alloca);
+            llvm::AllocaInst* alloca = create_entry_alloca(llvm_type, var_name);
+            session->object_registry.define(var_name, MemObject(explicit_type, alloca));
             var_ptr = alloca;
         }
         
         // If initial value provided, store it
+        // (for extern structs this copies the struct value directly)
         if (mol.atoms.size() >= 3) {
-            llvm::Value* val_ptr = get_stored_in(mol.atoms[2]);
-            if (val_ptr) {
-                if (is_extern_struct) {
-                    // For extern structs, copy the struct value directly
-                    llvm::Value* val = Builder->CreateLoad(llvm_type, val_ptr);
-                    Builder->CreateStore(val, var_ptr);
-                } else {
-                    llvm::Value* val = load_value(val_ptr, llvm_type);
-                    Builder->CreateStore(val, var_ptr);
-                }
+            StoredValue init = get_stored_in(mol.atoms[2]);
+            if (init) {
+                llvm::Value* val = load_value(init, llvm_type);
+                session->builder->CreateStore(val, var_ptr);
             }
         }
         
-        return {var_ptr};
+        return StoredValue::address(var_ptr);
     }
-    return {nullptr};
+    return {};
 }
 
 // = - reassignment of existing variable only
 IntrinsicResult build_reassign(Molecule& mol) {
     if (mol.atoms.size() >= 3) {
-        std::string var_name;
+        Symbol var_name;
         
         if (std::holds_alternative<Atom>(mol.atoms[1])) {
             Atom& var_atom = std::get<Atom>(mol.atoms[1]);
@@ -224,411 +261,426 @@ IntrinsicResult build_reassign(Molecule& mol) {
         }
         
         // Variable must already exist
-        if (!object_registry.count(var_name) || object_registry[var_name].value == nullptr) {
+        MemObject* var = session->object_registry.find(var_name);
+        if (!var || var->value == nullptr) {
             std::cerr << "Error: variable '" << var_name << "' not defined. Use def to declare." << std::endl;
-            return {nullptr};
+            return {};
         }
         
-        std::string var_type = object_registry[var_name].type;
+        TypeRef var_type = var->type;
+        llvm::Value* var_ptr = var->value;
+
+        // (= s>field value) stores into the field of the struct s points to, not into s
+        Atom& var_atom = std::get<Atom>(mol.atoms[1]);
+        if (!var_atom.member_access.empty() && is_struct_type(var_type)) {
+            StructDef& def = *var_type->struct_def();
+            auto field = std::find(def.field_names.begin(), def.field_names.end(), var_atom.member_access);
+            if (field == def.field_names.end()) {
+                std::cerr << "Error: struct " << var_type->name << " has no field '" << var_atom.member_access << "'" << std::endl;
+                return {};
+            }
+            size_t field_idx = field - def.field_names.begin();
+            llvm::Value* struct_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), var_ptr);
+            var_ptr = session->builder->CreateStructGEP(def.llvm_type, struct_ptr, field_idx);
+            var_type = def.field_types[field_idx];
+        }
+
         llvm::Type* llvm_type = get_llvm_type(var_type);
-        llvm::Value* val_ptr = get_stored_in(mol.atoms[2]);
-        if (!val_ptr) return {nullptr};
+        StoredValue new_value = get_stored_in(mol.atoms[2]);
+        if (!new_value) return {};
 
-        llvm::Value* val = load_value(val_ptr, llvm_type);
-        llvm::Value* var_ptr = object_registry[var_name].value;
-        Builder->CreateStore(val, var_ptr);
-        return {var_ptr};
+        llvm::Value* val = copy_stored_value(var_type, load_value(new_value, llvm_type));
+        session->builder->CreateStore(val, var_ptr);
+        return StoredValue::address(var_ptr);
     }
-    return {nullptr};
+    return {};
 }
 
-IntrinsicResult build_meow(Molecule& mol, const std::vector<llvm::Value*>& args) {
-    std::string type = get_particle_type(mol.atoms[1]);
+IntrinsicResult build_meow(Molecule& mol, const std::vector<StoredValue>& args) {
+    TypeRef type = get_particle_type(mol.atoms[1]);
     
-    if (type == "Str") {
+    if (type == STR_TYPE) {
         // String is now a struct, load the data pointer from it
-        llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-        llvm::StructType* str_struct_type = get_array_struct_type(char_type);
+        llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
         
-        llvm::Value* str_ptr_ptr = args[0];
-        llvm::Value* str_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), str_ptr_ptr, "str_ptr");
+        llvm::Value* str_ptr = load_value(args[0], llvm::PointerType::getUnqual(*session->context));
         
-        llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
-        llvm::Value* data_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), data_ptr_ptr, "data_ptr");
+        llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_ptr, 0, "size_ptr");
+        llvm::Value* size = session->builder->CreateLoad(llvm::Type::getInt32Ty(*session->context), size_ptr, "size");
+        llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
+        llvm::Value* data_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), data_ptr_ptr, "data_ptr");
         
-        std::vector<llvm::Type*> puts_args;
-        puts_args.push_back(llvm::PointerType::getUnqual(*TheContext));
-        llvm::FunctionType* puts_type = llvm::FunctionType::get(llvm::Type::getInt32Ty(*TheContext), puts_args, false);
-        llvm::FunctionCallee puts = TheModule->getOrInsertFunction("puts", puts_type);
-        Builder->CreateCall(puts, data_ptr);
+        emit_write_line(data_ptr, size);
     } 
     
-    return {nullptr};
+    return {};
+}
+
+// (meowf "x=" x " y=" y): each argument is formatted straight into the output buffer by its type,
+// without building a Str for it. String literals are used as they are (compile doesn't evaluate them).
+IntrinsicResult build_meowf(Molecule& mol) {
+    llvm::Type* ptr_type = llvm::PointerType::getUnqual(*session->context);
+    llvm::Type* int_type = llvm::Type::getInt32Ty(*session->context);
+    emit_begin_line();
+    for (size_t i = 1; i < mol.atoms.size(); i++) {
+        Particle& arg = mol.atoms[i];
+        if (std::holds_alternative<Atom>(arg) && std::get<Atom>(arg).quoted) {
+            const std::string& text = std::get<Atom>(arg).identifier;
+            if (!text.empty()) {
+                emit_write_str(string_literal(text), llvm::ConstantInt::get(int_type, text.size()));
+            }
+            continue;
+        }
+
+        TypeRef type = get_particle_type(arg);
+        StoredValue value = get_stored_in(arg);
+        if (!value) continue;
+        if (type == STR_TYPE) {
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+            llvm::Value* str_ptr = load_value(value, ptr_type);
+            llvm::Value* size = session->builder->CreateLoad(int_type, session->builder->CreateStructGEP(str_struct_type, str_ptr, 0, "size_ptr"), "size");
+            llvm::Value* data_ptr = session->builder->CreateLoad(ptr_type, session->builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr"), "data_ptr");
+            emit_write_str(data_ptr, size);
+        } else if (type == INT_TYPE) {
+            emit_write_int(load_value(value, int_type));
+        } else if (type == FLOAT_TYPE) {
+            emit_write_float(load_value(value, llvm::Type::getFloatTy(*session->context)));
+        } else if (type == CHAR_TYPE) {
+            emit_write_char(load_value(value, llvm::Type::getInt8Ty(*session->context)));
+        } else if (type == BOOL_TYPE) {
+            llvm::Value* b = load_value(value, llvm::Type::getInt1Ty(*session->context));
+            llvm::Value* text = session->builder->CreateSelect(b, string_literal("true"), string_literal("false"));
+            emit_write_str(text, session->builder->CreateSelect(b, llvm::ConstantInt::get(int_type, 4), llvm::ConstantInt::get(int_type, 5)));
+        }
+    }
+    emit_end_line();
+    return {};
 }
 
-IntrinsicResult build_return(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_return(Molecule& mol, const std::vector<StoredValue>& args) {
     if (args.empty()) {
-        Builder->CreateRetVoid();
+        session->builder->CreateRetVoid();
     } else {
-        std::string type = get_particle_type(mol.atoms[1]);
+        TypeRef type = get_particle_type(mol.atoms[1]);
         llvm::Type* llvm_type = get_llvm_type(type);
-        llvm::Value* val = load_value(args[0], llvm_type);
-        Builder->CreateRet(val);
+        llvm::Value* val = copy_stored_value(type, load_value(args[0], llvm_type));
+        session->builder->CreateRet(val);
     }
-    return {nullptr};
+    return {};
 }
 
 
-IntrinsicResult build_conv(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& out_type) {
-    std::string type = get_particle_type(mol.atoms[1]);
+IntrinsicResult build_conv(Molecule& mol, const std::vector<StoredValue>& args, TypeRef out_type) {
+    TypeRef type = get_particle_type(mol.atoms[1]);
 
     llvm::Type* llvm_type = get_llvm_type(type);
     
     llvm::Value* val = load_value(args[0], llvm_type);
     
-    if (out_type == "Str") {
-        if (type == "Char") {
+    if (out_type == STR_TYPE) {
+        if (type == CHAR_TYPE) {
             // For Char, create a 2-byte string (char + null terminator)
-            llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
+            llvm::Type* char_type = llvm::Type::getInt8Ty(*session->context);
             int buffer_size = 2;
             llvm::ArrayType* buffer_type = llvm::ArrayType::get(char_type, buffer_size);
-            llvm::AllocaInst* buffer = Builder->CreateAlloca(buffer_type);
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+            llvm::Value* str_alloc = create_temporary(str_struct_type, "conv_str_struct");
+            llvm::Value* buffer = create_temporary(buffer_type, "conv_buf", str_alloc);
             
             // Store the character
             std::vector<llvm::Value*> indices0 = {
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0),
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0)
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0),
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0)
             };
-            llvm::Value* char_ptr = Builder->CreateInBoundsGEP(buffer_type, buffer, indices0);
-            Builder->CreateStore(val, char_ptr);
+            llvm::Value* char_ptr = session->builder->CreateInBoundsGEP(buffer_type, buffer, indices0);
+            session->builder->CreateStore(val, char_ptr);
             
             // Store null terminator
             std::vector<llvm::Value*> indices1 = {
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0),
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1)
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0),
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1)
             };
-            llvm::Value* null_ptr = Builder->CreateInBoundsGEP(buffer_type, buffer, indices1);
-            Builder->CreateStore(llvm::ConstantInt::get(char_type, 0), null_ptr);
+            llvm::Value* null_ptr = session->builder->CreateInBoundsGEP(buffer_type, buffer, indices1);
+            session->builder->CreateStore(llvm::ConstantInt::get(char_type, 0), null_ptr);
             
             // Build string struct
-            llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-            llvm::AllocaInst* str_alloc = Builder->CreateAlloca(str_struct_type, nullptr, "conv_str_struct");
+            llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1), size_ptr);
             
-            llvm::Value* size_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1), size_ptr);
+            llvm::Value* cap_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), buffer_size), cap_ptr);
             
-            llvm::Value* cap_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), buffer_size), cap_ptr);
+            llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
+            session->builder->CreateStore(buffer, data_ptr_ptr);
             
-            llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
-            Builder->CreateStore(buffer, data_ptr_ptr);
-            
-            llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "str_ref");
-            Builder->CreateStore(str_alloc, result_ptr);
-
-            return {result_ptr};
-        } else if (type == "Int") {
-            llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-            int buffer_size = 12;
+            return StoredValue::rvalue(str_alloc);
+        } else if (type == INT_TYPE) {
+            llvm::Type* char_type = llvm::Type::getInt8Ty(*session->context);
+            int buffer_size = INT_STRING_SIZE;
             llvm::ArrayType* buffer_type = llvm::ArrayType::get(char_type, buffer_size);
-            llvm::AllocaInst* buffer = Builder->CreateAlloca(buffer_type);
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+            llvm::Value* str_alloc = create_temporary(str_struct_type, "conv_str_struct");
+            llvm::Value* buffer = create_temporary(buffer_type, "conv_buf", str_alloc);
 
-            llvm::Value* format_str = Builder->CreateGlobalString("%d");
-
-            std::vector<llvm::Type*> sprintf_args = {
-                llvm::PointerType::getUnqual(*TheContext),
-                llvm::PointerType::getUnqual(*TheContext)
-            };
-
-            llvm::FunctionType* sprintf_type = llvm::FunctionType::get(
-                llvm::Type::getInt32Ty(*TheContext), 
-                sprintf_args, 
-                true
-            );
-            
-            llvm::FunctionCallee sprintf_func = TheModule->getOrInsertFunction("sprintf", sprintf_type);
-            llvm::Value* written = Builder->CreateCall(sprintf_func, {buffer, format_str, val});
+            llvm::Value* written = emit_format_int(val, buffer);
 
             // Build string struct like string literals
-            llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-            llvm::AllocaInst* str_alloc = Builder->CreateAlloca(str_struct_type, nullptr, "conv_str_struct");
+            llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
+            session->builder->CreateStore(written, size_ptr);
             
-            llvm::Value* size_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
-            Builder->CreateStore(written, size_ptr);
+            llvm::Value* cap_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), buffer_size), cap_ptr);
             
-            llvm::Value* cap_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), buffer_size), cap_ptr);
+            llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
+            session->builder->CreateStore(buffer, data_ptr_ptr);
             
-            llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
-            Builder->CreateStore(buffer, data_ptr_ptr);
-            
-            llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "str_ref");
-            Builder->CreateStore(str_alloc, result_ptr);
-
-            return {result_ptr};
-        } else if (type == "Float") {
-            llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-            int buffer_size = 32;
+            return StoredValue::rvalue(str_alloc);
+        } else if (type == FLOAT_TYPE) {
+            llvm::Type* char_type = llvm::Type::getInt8Ty(*session->context);
+            int buffer_size = FLOAT_STRING_SIZE;
             llvm::ArrayType* buffer_type = llvm::ArrayType::get(char_type, buffer_size);
-            llvm::AllocaInst* buffer = Builder->CreateAlloca(buffer_type);
-
-            llvm::Value* format_str = Builder->CreateGlobalString("%f");
-
-            std::vector<llvm::Type*> sprintf_args = {
-                llvm::PointerType::getUnqual(*TheContext),
-                llvm::PointerType::getUnqual(*TheContext)
-            };
-
-            llvm::FunctionType* sprintf_type = llvm::FunctionType::get(
-                llvm::Type::getInt32Ty(*TheContext), 
-                sprintf_args, 
-                true
-            );
-            
-            llvm::FunctionCallee sprintf_func = TheModule->getOrInsertFunction("sprintf", sprintf_type);
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+            llvm::Value* str_alloc = create_temporary(str_struct_type, "conv_str_struct");
+            llvm::Value* buffer = create_temporary(buffer_type, "conv_buf", str_alloc);
 
-            llvm::Value* double_val = Builder->CreateFPExt(val, llvm::Type::getDoubleTy(*TheContext));
-            llvm::Value* written = Builder->CreateCall(sprintf_func, {buffer, format_str, double_val});
+            llvm::Value* written = emit_format_float(val, buffer);
 
             // Build string struct like string literals
-            llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-            llvm::AllocaInst* str_alloc = Builder->CreateAlloca(str_struct_type, nullptr, "conv_str_struct");
-            
-            llvm::Value* size_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
-            Builder->CreateStore(written, size_ptr);
+            llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
+            session->builder->CreateStore(written, size_ptr);
             
-            llvm::Value* cap_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), buffer_size), cap_ptr);
+            llvm::Value* cap_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), buffer_size), cap_ptr);
             
-            llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
-            Builder->CreateStore(buffer, data_ptr_ptr);
+            llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
+            session->builder->CreateStore(buffer, data_ptr_ptr);
             
-            llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "str_ref");
-            Builder->CreateStore(str_alloc, result_ptr);
-
-            return {result_ptr};
-        } else if (type == "Bool") {
-            // Bool to Str: "true" or "false"
-            llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-            
-            // Create global strings for "true" and "false"
-            llvm::Value* true_str = Builder->CreateGlobalString("true");
-            llvm::Value* false_str = Builder->CreateGlobalString("false");
+            return StoredValue::rvalue(str_alloc);
+        } else if (type == BOOL_TYPE) {
+            // Bool to Str: "true" or "false", from the module's string constants
+            llvm::Value* true_str = string_literal("true");
+            llvm::Value* false_str = string_literal("false");
             
             // Select based on boolean value
-            llvm::Value* selected_str = Builder->CreateSelect(val, true_str, false_str, "bool_str");
-            llvm::Value* selected_len = Builder->CreateSelect(val, 
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 4),
-                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 5),
+            llvm::Value* selected_str = session->builder->CreateSelect(val, true_str, false_str, "bool_str");
+            llvm::Value* selected_len = session->builder->CreateSelect(val, 
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 4),
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 5),
                 "bool_len");
             
             // Build string struct
-            llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-            llvm::AllocaInst* str_alloc = Builder->CreateAlloca(str_struct_type, nullptr, "conv_str_struct");
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
+            llvm::Value* str_alloc = create_temporary(str_struct_type, "conv_str_struct");
             
-            llvm::Value* size_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
-            Builder->CreateStore(selected_len, size_ptr);
+            llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 0, "size_ptr");
+            session->builder->CreateStore(selected_len, size_ptr);
             
-            llvm::Value* cap_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
-            Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 6), cap_ptr);
+            // Capacity 0: the characters are read-only, copied by the first write
+            llvm::Value* cap_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 1, "cap_ptr");
+            session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0), cap_ptr);
             
-            llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
-            Builder->CreateStore(selected_str, data_ptr_ptr);
+            llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_alloc, 2, "data_ptr_ptr");
+            session->builder->CreateStore(selected_str, data_ptr_ptr);
             
-            llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "str_ref");
-            Builder->CreateStore(str_alloc, result_ptr);
-
-            return {result_ptr};
+            return StoredValue::rvalue(str_alloc);
         }
-    } else if (out_type == "Int") {
-        if (type == "Str") {
+    } else if (out_type == INT_TYPE) {
+        if (type == STR_TYPE) {
             // Str is now a struct, need to extract data pointer first
-            llvm::Type* char_type = llvm::Type::getInt8Ty(*TheContext);
-            llvm::StructType* str_struct_type = get_array_struct_type(char_type);
-            
-            llvm::Value* str_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), args[0], "str_ptr");
-            llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
-            llvm::Value* data_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), data_ptr_ptr, "data_ptr");
-
-            llvm::Value* format_str = Builder->CreateGlobalString("%d");
-
-            std::vector<llvm::Type*> sscanf_args = {
-                llvm::PointerType::getUnqual(*TheContext),
-                llvm::PointerType::getUnqual(*TheContext)
-            };
-
-            llvm::FunctionType* sscanf_type = llvm::FunctionType::get(
-                llvm::Type::getInt32Ty(*TheContext), 
-                sscanf_args, 
-                true
-            );
+            llvm::StructType* str_struct_type = get_array_struct_type(STR_TYPE);
             
-            llvm::FunctionCallee sscanf_func = TheModule->getOrInsertFunction("sscanf", sscanf_type);
-            
-            llvm::AllocaInst* result_int = Builder->CreateAlloca(llvm::Type::getInt32Ty(*TheContext));
-            
-            Builder->CreateCall(sscanf_func, {data_ptr, format_str, result_int});
+            llvm::Value* str_ptr = load_value(args[0], llvm::PointerType::getUnqual(*session->context));
+            llvm::Value* size_ptr = session->builder->CreateStructGEP(str_struct_type, str_ptr, 0, "size_ptr");
+            llvm::Value* size = session->builder->CreateLoad(llvm::Type::getInt32Ty(*session->context), size_ptr, "size");
+            llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(str_struct_type, str_ptr, 2, "data_ptr_ptr");
+            llvm::Value* data_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), data_ptr_ptr, "data_ptr");
 
-            return {result_int};
+            llvm::Value* parsed = emit_parse_int(data_ptr, size);
+            return StoredValue::rvalue(parsed);
         } 
     }
     
 
-    return {nullptr};
+    return {};
 }
 
-IntrinsicResult build_array(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_array(Molecule& mol, const std::vector<StoredValue>& args) {
     if (args.empty()) {
         return {}; 
     }
 
-    std::string element_type_str = get_particle_type(mol.atoms[1]);
-    llvm::Type* element_type = get_llvm_type(element_type_str);
+    TypeRef element_type_ref = get_particle_type(mol.atoms[1]);
+    llvm::Type* element_type = get_llvm_type(element_type_ref);
     
     int size = args.size();
     int capacity = std::pow(2, std::ceil(std::log2(size)));
 
-    llvm::StructType* array_type = get_array_struct_type(element_type);
-    llvm::AllocaInst* array_alloc = Builder->CreateAlloca(array_type, nullptr, "array_struct");
+    llvm::StructType* array_type = get_array_struct_type(array_type_of(element_type_ref));
+    llvm::Value* array_alloc = create_temporary(array_type, "array_struct");
 
-    llvm::Value* size_ptr = Builder->CreateStructGEP(array_type, array_alloc, 0, "size_ptr");
-    Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), size), size_ptr);
+    llvm::Value* size_ptr = session->builder->CreateStructGEP(array_type, array_alloc, 0, "size_ptr");
+    session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), size), size_ptr);
 
-    llvm::Value* cap_ptr = Builder->CreateStructGEP(array_type, array_alloc, 1, "cap_ptr");
-    Builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), capacity), cap_ptr);
+    llvm::Value* cap_ptr = session->builder->CreateStructGEP(array_type, array_alloc, 1, "cap_ptr");
+    session->builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), capacity), cap_ptr);
 
-    llvm::ArrayType* data_array_type = llvm::ArrayType::get(element_type, size);
-    llvm::AllocaInst* data_alloc = Builder->CreateAlloca(data_array_type, nullptr, "data_arr");
+    // Back the whole capacity so append can fill it before growing
+    llvm::ArrayType* data_array_type = llvm::ArrayType::get(element_type, capacity);
+    llvm::Value* data_alloc = create_temporary(data_array_type, "data_arr", array_alloc);
     
-    for (int i = 0; i < size; ++i) {
-        llvm::Value* val = load_value(args[i], element_type);
-        std::vector<llvm::Value*> indices = {
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0),
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), i)
-        };
-        llvm::Value* ptr = Builder->CreateInBoundsGEP(data_array_type, data_alloc, indices, "elem_ptr");
-        Builder->CreateStore(val, ptr);
+    std::vector<llvm::Value*> values;
+    for (const StoredValue& arg : args) {
+        values.push_back(copy_stored_value(element_type_ref, load_value(arg, element_type)));
+    }
+    // A table of constants is copied in whole
+    if (!copy_constant_literal(data_alloc, llvm::ArrayType::get(element_type, size), values)) {
+        for (int i = 0; i < size; ++i) {
+            std::vector<llvm::Value*> indices = {
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0),
+                llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), i)
+            };
+            llvm::Value* ptr = session->builder->CreateInBoundsGEP(data_array_type, data_alloc, indices, "elem_ptr");
+            session->builder->CreateStore(values[i], ptr);
+        }
     }
 
-    llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(array_type, array_alloc, 2, "data_ptr_ptr");
-    llvm::Value* data_ptr = Builder->CreateBitCast(data_alloc, llvm::PointerType::getUnqual(*TheContext));
-    Builder->CreateStore(data_ptr, data_ptr_ptr);
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(array_type, array_alloc, 2, "data_ptr_ptr");
+    llvm::Value* data_ptr = session->builder->CreateBitCast(data_alloc, llvm::PointerType::getUnqual(*session->context));
+    session->builder->CreateStore(data_ptr, data_ptr_ptr);
 
-    llvm::AllocaInst* result_ptr = Builder->CreateAlloca(llvm::PointerType::getUnqual(*TheContext), nullptr, "array_ref");
-    Builder->CreateStore(array_alloc, result_ptr);
+    return StoredValue::rvalue(array_alloc);
+}
 
-    return {result_ptr};
+// A capacity of 0 means the array doesn't own its data: it is read-only (a borrowed literal's) or there is none.
+// Literals that may be written get their own copy where they are evaluated, so this heap copy is only for
+// data of unknown origin. Returns the data pointer to write through.
+static llvm::Value* own_array_data(TypeRef array_type, llvm::Value* array_ptr) {
+    llvm::Type* element_type = get_llvm_type(array_element_type(array_type));
+    llvm::StructType* array_struct_type = get_array_struct_type(array_type);
+    llvm::Type* i32_type = llvm::Type::getInt32Ty(*session->context);
+    llvm::Type* i64_type = llvm::Type::getInt64Ty(*session->context);
+    llvm::Type* ptr_type = llvm::PointerType::getUnqual(*session->context);
+
+    llvm::Value* size = session->builder->CreateLoad(i32_type, session->builder->CreateStructGEP(array_struct_type, array_ptr, 0), "size");
+    llvm::Value* cap_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 1, "cap_ptr");
+    llvm::Value* capacity = session->builder->CreateLoad(i32_type, cap_ptr, "capacity");
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 2, "data_ptr_ptr");
+
+    llvm::Function* func = session->builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* copyBB = llvm::BasicBlock::Create(*session->context, "own", func);
+    llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*session->context, "owned", func);
+    session->builder->CreateCondBr(session->builder->CreateICmpEQ(capacity, llvm::ConstantInt::get(i32_type, 0)), copyBB, mergeBB);
+    session->builder->SetInsertPoint(copyBB);
+
+    // sizeof(T) via GEP from null; must not be inbounds or the offset is poison
+    llvm::Value* size_of_elem = session->builder->CreatePtrToInt(
+        session->builder->CreateGEP(element_type, llvm::Constant::getNullValue(ptr_type), llvm::ConstantInt::get(i32_type, 1)), i64_type);
+
+    // One more than size, so there is room for a Str's NUL and the capacity is never 0 again
+    llvm::Value* new_cap = session->builder->CreateAdd(size, llvm::ConstantInt::get(i32_type, 1));
+    llvm::Value* copied = array_type == STR_TYPE ? new_cap : size;
+
+    llvm::FunctionCallee malloc_func = session->module->getOrInsertFunction("malloc", llvm::FunctionType::get(ptr_type, {i64_type}, false));
+    llvm::Value* new_data = session->builder->CreateCall(malloc_func, {session->builder->CreateMul(session->builder->CreateZExt(new_cap, i64_type), size_of_elem)});
+    llvm::FunctionCallee memcpy_func = session->module->getOrInsertFunction("memcpy",
+        llvm::FunctionType::get(ptr_type, {ptr_type, ptr_type, i64_type}, false));
+    session->builder->CreateCall(memcpy_func, {
+        new_data,
+        session->builder->CreateLoad(ptr_type, data_ptr_ptr, "data_ptr"),
+        session->builder->CreateMul(session->builder->CreateZExt(copied, i64_type), size_of_elem)
+    });
+    session->builder->CreateStore(new_cap, cap_ptr);
+    session->builder->CreateStore(new_data, data_ptr_ptr);
+    session->builder->CreateBr(mergeBB);
+    session->builder->SetInsertPoint(mergeBB);
+
+    return session->builder->CreateLoad(ptr_type, data_ptr_ptr, "data_ptr");
 }
 
-IntrinsicResult build_array_element(Molecule& mol, const std::vector<llvm::Value*>& args, std::string name) {
+IntrinsicResult build_array_element(Molecule& mol, const std::vector<StoredValue>& args, std::string name) {
     if (args.empty()) {
         return {}; 
     }
 
-    std::string array_type_str = get_particle_type(mol.atoms[1]);
-    std::string element_type_str = get_array_element_type_str(array_type_str);
-    llvm::Type* element_type = get_llvm_type(element_type_str);
+    TypeRef array_type = get_particle_type(mol.atoms[1]);
+    llvm::Type* element_type = get_llvm_type(array_element_type(array_type));
 
-    if (name == "get" && args.size() < 2) return {nullptr};
-    if (name == "set" && args.size() < 3) return {nullptr};
+    if (name == "get" && args.size() < 2) return {};
+    if (name == "set" && args.size() < 3) return {};
 
-    llvm::Value* index_ptr = args[1];
-    llvm::Value* array_ptr_ptr = args[0];
-
-    llvm::Value* array_ptr = Builder->CreateLoad(
-        llvm::PointerType::getUnqual(*TheContext), 
-        array_ptr_ptr, 
-        "array_ptr"
-    );
+    llvm::Value* array_ptr = load_value(args[0], llvm::PointerType::getUnqual(*session->context));
 
-    llvm::StructType* array_struct_type = get_array_struct_type(element_type);
+    llvm::StructType* array_struct_type = get_array_struct_type(array_type);
     
-    llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(array_struct_type, array_ptr, 2, "data_ptr_ptr");
-    llvm::Value* data_ptr = Builder->CreateLoad(
-        llvm::PointerType::getUnqual(*TheContext), 
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 2, "data_ptr_ptr");
+    llvm::Value* data_ptr = session->builder->CreateLoad(
+        llvm::PointerType::getUnqual(*session->context), 
         data_ptr_ptr, 
         "data_ptr"
     );
 
-    llvm::Value* index = Builder->CreateLoad(
-        llvm::Type::getInt32Ty(*TheContext), 
-        index_ptr, 
-        "index"
-    );
+    llvm::Value* index = load_value(args[1], llvm::Type::getInt32Ty(*session->context));
     
     if (name == "get") {
-        llvm::Value* element_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, index, "elem_ptr");
-        llvm::Value* element_val = Builder->CreateLoad(element_type, element_ptr, "elem_val");
-
-        llvm::AllocaInst* result_alloca = Builder->CreateAlloca(element_type);
-        Builder->CreateStore(element_val, result_alloca);
-        return {result_alloca};
+        llvm::Value* element_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, index, "elem_ptr");
+        llvm::Value* element_val = session->builder->CreateLoad(element_type, element_ptr, "elem_val");
+        return StoredValue::rvalue(element_val);
     } else if (name == "set") {
-        llvm::Value* element_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, index, "elem_ptr");
+        data_ptr = own_array_data(array_type, array_ptr);
+        llvm::Value* element_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, index, "elem_ptr");
 
-        llvm::Value* value = load_value(args[2], element_type);
-        Builder->CreateStore(value, element_ptr);
+        llvm::Value* value = copy_stored_value(array_element_type(array_type), load_value(args[2], element_type));
+        session->builder->CreateStore(value, element_ptr);
 
-        return {nullptr};
+        return {};
     }
 
-    return {nullptr};
+    return {};
 }
 
-IntrinsicResult build_array_size(Molecule& mol, const std::vector<llvm::Value*>& args) {
+IntrinsicResult build_array_size(Molecule& mol, const std::vector<StoredValue>& args) {
     if (args.empty()) {
         return {}; 
     }
 
-    std::string array_type_str = get_particle_type(mol.atoms[1]);
-    std::string element_type_str = get_array_element_type_str(array_type_str);
-    llvm::Type* element_type = get_llvm_type(element_type_str);
+    TypeRef array_type = get_particle_type(mol.atoms[1]);
 
-    llvm::Value* array_ptr_ptr = args[0];
-
-    llvm::Value* array_ptr = Builder->CreateLoad(
-        llvm::PointerType::getUnqual(*TheContext), 
-        array_ptr_ptr, 
-        "array_ptr"
-    );
+    llvm::Value* array_ptr = load_value(args[0], llvm::PointerType::getUnqual(*session->context));
 
-    llvm::StructType* array_struct_type = get_array_struct_type(element_type);
+    llvm::StructType* array_struct_type = get_array_struct_type(array_type);
     
-    llvm::Value* size_ptr = Builder->CreateStructGEP(array_struct_type, array_ptr, 0, "size_ptr");
-    llvm::Value* size = Builder->CreateLoad(
-        llvm::Type::getInt32Ty(*TheContext), 
+    llvm::Value* size_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 0, "size_ptr");
+    llvm::Value* size = session->builder->CreateLoad(
+        llvm::Type::getInt32Ty(*session->context), 
         size_ptr, 
         "size"
     );
 
-    llvm::AllocaInst* result_alloca = Builder->CreateAlloca(llvm::Type::getInt32Ty(*TheContext));
-    Builder->CreateStore(size, result_alloca);
-    return {result_alloca};
+    return StoredValue::rvalue(size);
 }
 
-IntrinsicResult build_array_memshift(Molecule& mol, const std::vector<llvm::Value*>& args, std::string name) {
+IntrinsicResult build_array_memshift(Molecule& mol, const std::vector<StoredValue>& args, std::string name) {
     if (args.empty()) return {};
 
-    llvm::Value* array_ptr_ptr = args[0];
-    std::string array_type_str = get_particle_type(mol.atoms[1]);
-    std::string element_type_str = get_array_element_type_str(array_type_str);
-    llvm::Type* element_type = get_llvm_type(element_type_str);
-    llvm::StructType* array_struct_type = get_array_struct_type(element_type);
+    TypeRef array_type = get_particle_type(mol.atoms[1]);
+    llvm::Type* element_type = get_llvm_type(array_element_type(array_type));
+    llvm::StructType* array_struct_type = get_array_struct_type(array_type);
 
-    llvm::Value* array_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), array_ptr_ptr, "array_ptr");
+    llvm::Value* array_ptr = load_value(args[0], llvm::PointerType::getUnqual(*session->context));
     
-    llvm::Value* size_ptr = Builder->CreateStructGEP(array_struct_type, array_ptr, 0, "size_ptr");
-    llvm::Value* size = Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), size_ptr, "size");
+    llvm::Value* size_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 0, "size_ptr");
+    llvm::Value* size = session->builder->CreateLoad(llvm::Type::getInt32Ty(*session->context), size_ptr, "size");
     
-    llvm::Value* cap_ptr = Builder->CreateStructGEP(array_struct_type, array_ptr, 1, "cap_ptr");
-    llvm::Value* capacity = Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), cap_ptr, "capacity");
+    llvm::Value* cap_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 1, "cap_ptr");
+    llvm::Value* capacity = session->builder->CreateLoad(llvm::Type::getInt32Ty(*session->context), cap_ptr, "capacity");
     
-    llvm::Value* data_ptr_ptr = Builder->CreateStructGEP(array_struct_type, array_ptr, 2, "data_ptr_ptr");
-    llvm::Value* data_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), data_ptr_ptr, "data_ptr");
+    llvm::Value* data_ptr_ptr = session->builder->CreateStructGEP(array_struct_type, array_ptr, 2, "data_ptr_ptr");
+    llvm::Value* data_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), data_ptr_ptr, "data_ptr");
 
-    llvm::Value* size_of_elem = Builder->CreatePtrToInt(
-        Builder->CreateInBoundsGEP(element_type, llvm::Constant::getNullValue(llvm::PointerType::getUnqual(*TheContext)), llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1)),
-        llvm::Type::getInt64Ty(*TheContext)
+    // sizeof(T) via GEP from null; must not be inbounds or the offset is poison
+    llvm::Value* size_of_elem = session->builder->CreatePtrToInt(
+        session->builder->CreateGEP(element_type, llvm::Constant::getNullValue(llvm::PointerType::getUnqual(*session->context)), llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1)),
+        llvm::Type::getInt64Ty(*session->context)
     );
 
     
@@ -637,280 +689,284 @@ IntrinsicResult build_array_memshift(Molecule& mol, const std::vector<llvm::Valu
         // get more memory if needed
         // For strings, we need room for null terminator, so grow when size+1 >= capacity
         llvm::Value* cond;
-        if (array_type_str == "Str") {
-            llvm::Value* size_plus_one = Builder->CreateAdd(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1));
-            cond = Builder->CreateICmpUGE(size_plus_one, capacity);
+        if (array_type == STR_TYPE) {
+            llvm::Value* size_plus_one = session->builder->CreateAdd(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1));
+            cond = session->builder->CreateICmpUGE(size_plus_one, capacity);
         } else {
-            cond = Builder->CreateICmpEQ(size, capacity);
+            cond = session->builder->CreateICmpEQ(size, capacity);
         }
-        llvm::BasicBlock* thenBB = llvm::BasicBlock::Create(*TheContext, "grow", Builder->GetInsertBlock()->getParent());
-        llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*TheContext, "cont", Builder->GetInsertBlock()->getParent());
+        llvm::BasicBlock* thenBB = llvm::BasicBlock::Create(*session->context, "grow", session->builder->GetInsertBlock()->getParent());
+        llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*session->context, "cont", session->builder->GetInsertBlock()->getParent());
         
-        Builder->CreateCondBr(cond, thenBB, mergeBB);
-        Builder->SetInsertPoint(thenBB);
+        session->builder->CreateCondBr(cond, thenBB, mergeBB);
+        session->builder->SetInsertPoint(thenBB);
 
-        llvm::Value* cap_is_zero = Builder->CreateICmpEQ(capacity, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 0));
-        llvm::Value* double_cap = Builder->CreateMul(capacity, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 2));
-        llvm::Value* new_cap = Builder->CreateSelect(cap_is_zero, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1), double_cap);
+        llvm::Value* cap_is_zero = session->builder->CreateICmpEQ(capacity, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 0));
+        llvm::Value* double_cap = session->builder->CreateMul(capacity, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 2));
+        // From capacity 0 (no data, or a literal's read-only data) straight to what the new size needs
+        llvm::Value* needed_cap = session->builder->CreateAdd(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), array_type == STR_TYPE ? 2 : 1));
+        llvm::Value* new_cap = session->builder->CreateSelect(cap_is_zero, needed_cap, double_cap);
 
-        llvm::Value* total_size = Builder->CreateMul(Builder->CreateZExt(new_cap, llvm::Type::getInt64Ty(*TheContext)), size_of_elem);
+        llvm::Value* total_size = session->builder->CreateMul(session->builder->CreateZExt(new_cap, llvm::Type::getInt64Ty(*session->context)), size_of_elem);
 
-        llvm::FunctionCallee malloc_func = TheModule->getOrInsertFunction("malloc", 
-            llvm::FunctionType::get(llvm::PointerType::getUnqual(*TheContext), {llvm::Type::getInt64Ty(*TheContext)}, false));
-        llvm::Value* new_data = Builder->CreateBitCast(Builder->CreateCall(malloc_func, {total_size}), llvm::PointerType::getUnqual(*TheContext));
+        llvm::FunctionCallee malloc_func = session->module->getOrInsertFunction("malloc", 
+            llvm::FunctionType::get(llvm::PointerType::getUnqual(*session->context), {llvm::Type::getInt64Ty(*session->context)}, false));
+        llvm::Value* new_data = session->builder->CreateBitCast(session->builder->CreateCall(malloc_func, {total_size}), llvm::PointerType::getUnqual(*session->context));
         
-        llvm::Value* current_bytes = Builder->CreateMul(Builder->CreateZExt(size, llvm::Type::getInt64Ty(*TheContext)), size_of_elem);
-        llvm::FunctionCallee memcpy_func = TheModule->getOrInsertFunction("memcpy",
-            llvm::FunctionType::get(llvm::PointerType::getUnqual(*TheContext), 
-            {llvm::PointerType::getUnqual(*TheContext), llvm::PointerType::getUnqual(*TheContext), llvm::Type::getInt64Ty(*TheContext)}, false));
+        llvm::Value* current_bytes = session->builder->CreateMul(session->builder->CreateZExt(size, llvm::Type::getInt64Ty(*session->context)), size_of_elem);
+        llvm::FunctionCallee memcpy_func = session->module->getOrInsertFunction("memcpy",
+            llvm::FunctionType::get(llvm::PointerType::getUnqual(*session->context), 
+            {llvm::PointerType::getUnqual(*session->context), llvm::PointerType::getUnqual(*session->context), llvm::Type::getInt64Ty(*session->context)}, false));
         
-        Builder->CreateCall(memcpy_func, {
-            Builder->CreateBitCast(new_data, llvm::PointerType::getUnqual(*TheContext)),
-            Builder->CreateBitCast(data_ptr, llvm::PointerType::getUnqual(*TheContext)),
+        session->builder->CreateCall(memcpy_func, {
+            session->builder->CreateBitCast(new_data, llvm::PointerType::getUnqual(*session->context)),
+            session->builder->CreateBitCast(data_ptr, llvm::PointerType::getUnqual(*session->context)),
             current_bytes
         });
         
-        Builder->CreateStore(new_cap, cap_ptr);
-        Builder->CreateStore(new_data, data_ptr_ptr);
-        Builder->CreateBr(mergeBB);
-        Builder->SetInsertPoint(mergeBB);
+        session->builder->CreateStore(new_cap, cap_ptr);
+        session->builder->CreateStore(new_data, data_ptr_ptr);
+        session->builder->CreateBr(mergeBB);
+        session->builder->SetInsertPoint(mergeBB);
         
-        data_ptr = Builder->CreateLoad(llvm::PointerType::getUnqual(*TheContext), data_ptr_ptr, "data_ptr_reloaded");
+        data_ptr = session->builder->CreateLoad(llvm::PointerType::getUnqual(*session->context), data_ptr_ptr, "data_ptr_reloaded");
         
-        llvm::Value* idx = (name == "append") ? size : Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), args[1]);
-        llvm::Value* val = load_value((name == "append") ? args[1] : args[2], element_type);
+        llvm::Value* idx = (name == "append") ? size : load_value(args[1], llvm::Type::getInt32Ty(*session->context));
+        llvm::Value* val = copy_stored_value(array_element_type(array_type), load_value((name == "append") ? args[1] : args[2], element_type));
 
         if (name == "insert") {
-            llvm::Value* move_size = Builder->CreateSub(size, idx);
-            llvm::Value* move_bytes = Builder->CreateMul(Builder->CreateZExt(move_size, llvm::Type::getInt64Ty(*TheContext)), size_of_elem);
+            llvm::Value* move_size = session->builder->CreateSub(size, idx);
+            llvm::Value* move_bytes = session->builder->CreateMul(session->builder->CreateZExt(move_size, llvm::Type::getInt64Ty(*session->context)), size_of_elem);
             
-            llvm::Value* src_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, idx);
-            llvm::Value* dst_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, Builder->CreateAdd(idx, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1)));
+            llvm::Value* src_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, idx);
+            llvm::Value* dst_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, session->builder->CreateAdd(idx, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1)));
             
-            llvm::FunctionCallee memmove_func = TheModule->getOrInsertFunction("memmove",
-                llvm::FunctionType::get(llvm::PointerType::getUnqual(*TheContext), 
-                {llvm::PointerType::getUnqual(*TheContext), llvm::PointerType::getUnqual(*TheContext), llvm::Type::getInt64Ty(*TheContext)}, false));
+            llvm::FunctionCallee memmove_func = session->module->getOrInsertFunction("memmove",
+                llvm::FunctionType::get(llvm::PointerType::getUnqual(*session->context), 
+                {llvm::PointerType::getUnqual(*session->context), llvm::PointerType::getUnqual(*session->context), llvm::Type::getInt64Ty(*session->context)}, false));
             
-            Builder->CreateCall(memmove_func, {
-                Builder->CreateBitCast(dst_ptr, llvm::PointerType::getUnqual(*TheContext)),
-                Builder->CreateBitCast(src_ptr, llvm::PointerType::getUnqual(*TheContext)),
+            session->builder->CreateCall(memmove_func, {
+                session->builder->CreateBitCast(dst_ptr, llvm::PointerType::getUnqual(*session->context)),
+                session->builder->CreateBitCast(src_ptr, llvm::PointerType::getUnqual(*session->context)),
                 move_bytes
             });
         }
 
-        Builder->CreateStore(val, Builder->CreateInBoundsGEP(element_type, data_ptr, idx));
-        llvm::Value* new_size = Builder->CreateAdd(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1));
-        Builder->CreateStore(new_size, size_ptr);
+        session->builder->CreateStore(val, session->builder->CreateInBoundsGEP(element_type, data_ptr, idx));
+        llvm::Value* new_size = session->builder->CreateAdd(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1));
+        session->builder->CreateStore(new_size, size_ptr);
         
         // Add null terminator for strings
-        if (array_type_str == "Str") {
-            llvm::Value* null_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
-            Builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
+        if (array_type == STR_TYPE) {
+            llvm::Value* null_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
+            session->builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
         }
         
-        return {array_ptr_ptr};
+        return args[0];
     } 
     else if (name == "remove") {
-        llvm::Value* idx = Builder->CreateLoad(llvm::Type::getInt32Ty(*TheContext), args[1]);
-        llvm::Value* move_size = Builder->CreateSub(Builder->CreateSub(size, idx), llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1));
-        llvm::Value* move_bytes = Builder->CreateMul(Builder->CreateZExt(move_size, llvm::Type::getInt64Ty(*TheContext)), size_of_elem);
+        data_ptr = own_array_data(array_type, array_ptr);
+        llvm::Value* idx = load_value(args[1], llvm::Type::getInt32Ty(*session->context));
+        llvm::Value* move_size = session->builder->CreateSub(session->builder->CreateSub(size, idx), llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1));
+        llvm::Value* move_bytes = session->builder->CreateMul(session->builder->CreateZExt(move_size, llvm::Type::getInt64Ty(*session->context)), size_of_elem);
         
-        llvm::Value* dst_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, idx);
-        llvm::Value* src_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, Builder->CreateAdd(idx, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1)));
+        llvm::Value* dst_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, idx);
+        llvm::Value* src_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, session->builder->CreateAdd(idx, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1)));
         
-        llvm::FunctionCallee memmove_func = TheModule->getOrInsertFunction("memmove",
-            llvm::FunctionType::get(llvm::PointerType::getUnqual(*TheContext), 
-            {llvm::PointerType::getUnqual(*TheContext), llvm::PointerType::getUnqual(*TheContext), llvm::Type::getInt64Ty(*TheContext)}, false));
+        llvm::FunctionCallee memmove_func = session->module->getOrInsertFunction("memmove",
+            llvm::FunctionType::get(llvm::PointerType::getUnqual(*session->context), 
+            {llvm::PointerType::getUnqual(*session->context), llvm::PointerType::getUnqual(*session->context), llvm::Type::getInt64Ty(*session->context)}, false));
             
-        Builder->CreateCall(memmove_func, {
-            Builder->CreateBitCast(dst_ptr, llvm::PointerType::getUnqual(*TheContext)),
-            Builder->CreateBitCast(src_ptr, llvm::PointerType::getUnqual(*TheContext)),
+        session->builder->CreateCall(memmove_func, {
+            session->builder->CreateBitCast(dst_ptr, llvm::PointerType::getUnqual(*session->context)),
+            session->builder->CreateBitCast(src_ptr, llvm::PointerType::getUnqual(*session->context)),
             move_bytes
         });
         
-        llvm::Value* new_size = Builder->CreateSub(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1));
-        Builder->CreateStore(new_size, size_ptr);
+        llvm::Value* new_size = session->builder->CreateSub(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1));
+        session->builder->CreateStore(new_size, size_ptr);
         
         // Add null terminator for strings
-        if (array_type_str == "Str") {
-            llvm::Value* null_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
-            Builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
+        if (array_type == STR_TYPE) {
+            llvm::Value* null_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
+            session->builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
         }
         
-        return {array_ptr_ptr};
+        return args[0];
     }
     else if (name == "pop_back") {
-        llvm::Value* new_size = Builder->CreateSub(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*TheContext), 1));
-        Builder->CreateStore(new_size, size_ptr);
+        data_ptr = own_array_data(array_type, array_ptr);
+        llvm::Value* new_size = session->builder->CreateSub(size, llvm::ConstantInt::get(llvm::Type::getInt32Ty(*session->context), 1));
+        session->builder->CreateStore(new_size, size_ptr);
         
-        llvm::Value* val = Builder->CreateLoad(element_type, Builder->CreateInBoundsGEP(element_type, data_ptr, new_size));
+        llvm::Value* val = session->builder->CreateLoad(element_type, session->builder->CreateInBoundsGEP(element_type, data_ptr, new_size));
         
         // Add null terminator for strings
-        if (array_type_str == "Str") {
-            llvm::Value* null_ptr = Builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
-            Builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
+        if (array_type == STR_TYPE) {
+            llvm::Value* null_ptr = session->builder->CreateInBoundsGEP(element_type, data_ptr, new_size);
+            session->builder->CreateStore(llvm::ConstantInt::get(element_type, 0), null_ptr);
         }
         
-        llvm::AllocaInst* result_alloca = Builder->CreateAlloca(element_type);
-        Builder->CreateStore(val, result_alloca);
-        return {result_alloca};
+        return StoredValue::rvalue(val);
     }
 
-    return {nullptr};
+    return {};
 }
 
 void init_intrinsics() {
     // arithmetic type: int+int=int, float+float=float
-    auto arithmetic_type = [](const std::vector<Particle>& args) -> std::string {
+    auto arithmetic_type = [](const List& args) -> TypeRef {
         if (args.size() >= 2) {
-            std::string t1 = get_particle_type(args[0]);
-            std::string t2 = get_particle_type(args[1]);
-            if (t1 == "Int" && t2 == "Int") return "Int";
-            if (t1 == "Float" && t2 == "Float") return "Float";
-            if (t1 == "Var" || t2 == "Var") return "Var";
+            TypeRef t1 = get_particle_type(args[0]);
+            TypeRef t2 = get_particle_type(args[1]);
+            if (t1 == INT_TYPE && t2 == INT_TYPE) return INT_TYPE;
+            if (t1 == FLOAT_TYPE && t2 == FLOAT_TYPE) return FLOAT_TYPE;
+            if (t1 == VAR_TYPE || t2 == VAR_TYPE) return VAR_TYPE;
         }
-        return "Nil";
+        return NIL_TYPE;
     };
 
     // comparison always returns bool
-    auto comparison_type = [](const std::vector<Particle>&) -> std::string {
-        return "Bool";
+    auto comparison_type = [](const List&) -> TypeRef {
+        return BOOL_TYPE;
     };
 
     // def - declaration requires type annotation
-    auto def_type = [](const std::vector<Particle>& args) -> std::string {
+    auto def_type = [](const List& args) -> TypeRef {
         if (args.size() >= 1) {
             if (std::holds_alternative<Atom>(args[0])) {
                 const Atom& var_atom = std::get<Atom>(args[0]);
-                std::string explicit_type = var_atom.type;
+                TypeRef explicit_type = var_atom.type;
                 
-                if (explicit_type.empty()) {
+                if (!explicit_type) {
                     std::cerr << "Error: def requires type annotation (e.g., def Int:x)" << std::endl;
-                    return "Nil";
+                    return NIL_TYPE;
                 }
                 
-                std::string var_name = var_atom.identifier;
-                if (!object_registry.count(var_name)) {
-                    object_registry[var_name] = MemObject(explicit_type, nullptr);
-                }
                 return explicit_type;
             }
         }
-        return "Nil";
+        return NIL_TYPE;
     };
     
     // = - reassignment uses existing variable type
-    auto reassign_type = [](const std::vector<Particle>& args) -> std::string {
+    auto reassign_type = [](const List& args) -> TypeRef {
         if (args.size() >= 2) {
             if (std::holds_alternative<Atom>(args[0])) {
-                std::string var_name = std::get<Atom>(args[0]).identifier;
-                if (object_registry.count(var_name)) {
-                    return object_registry[var_name].type;
+                if (MemObject* var = session->object_registry.find(std::get<Atom>(args[0]).identifier)) {
+                    return var->type;
                 }
             }
         }
-        return "Nil";
+        return NIL_TYPE;
     };
     
     // get the first argument's type
-    auto infer_first_type = [](const std::vector<Particle>& args) -> std::string {
-        if (args.empty()) return "Nil";
+    auto infer_first_type = [](const List& args) -> TypeRef {
+        if (args.empty()) return NIL_TYPE;
         return get_particle_type(args[0]);
     };
 
     // return Str
-    auto str_type = [](const std::vector<Particle>&) -> std::string {
-        return "Str";
+    auto str_type = [](const List&) -> TypeRef {
+        return STR_TYPE;
     };
 
     // return Int
-    auto int_type = [](const std::vector<Particle>&) -> std::string {
-        return "Int";
+    auto int_type = [](const List&) -> TypeRef {
+        return INT_TYPE;
     };
 
     // return nothing
-    auto nil_type = [](const std::vector<Particle>&) -> std::string {
-        return "Nil";
+    auto nil_type = [](const List&) -> TypeRef {
+        return NIL_TYPE;
     };
 
     // infer the type of the array element (for get operation)
-    auto infer_array_type = [](const std::vector<Particle>& args) -> std::string {
-        std::string particle_type = get_particle_type(args[0]);
-        if (particle_type == "Str") return "Char";
-        return get_array_element_type_str(particle_type);
+    auto infer_array_type = [](const List& args) -> TypeRef {
+        return array_element_type(get_particle_type(args[0]));
     };
 
     // infer the type of an element of the array
-    auto infer_element_type = [](const std::vector<Particle>& args) -> std::string {
-        if (args.empty()) return "Nil";
-        std::string particle_type = get_particle_type(args[0]);
-        if (particle_type == "Str") return "Char";
-        return get_array_element_type_str(particle_type);
+    auto infer_element_type = [](const List& args) -> TypeRef {
+        if (args.empty()) return NIL_TYPE;
+        return array_element_type(get_particle_type(args[0]));
     };
 
     // returns first arg type (for append/insert/remove on arrays and strings)
-    auto infer_array_self_type = [](const std::vector<Particle>& args) -> std::string {
-        if (args.empty()) return "Nil";
+    auto infer_array_self_type = [](const List& args) -> TypeRef {
+        if (args.empty()) return NIL_TYPE;
         return get_particle_type(args[0]);
     };
     
 
     // arithmetic
-    INTRINSICS["+"] = Function("+", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_arith(mol, args, "+"); }, arithmetic_type);
-    INTRINSICS["-"] = Function("-", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_arith(mol, args, "-"); }, arithmetic_type);
-    INTRINSICS["*"] = Function("*", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_arith(mol, args, "*"); }, arithmetic_type);
-    INTRINSICS["/"] = Function("/", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_arith(mol, args, "/"); }, arithmetic_type);
-    INTRINSICS["%"] = Function("%", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_arith(mol, args, "%"); }, arithmetic_type);
+    session->intrinsics["+"] = Function("+", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_arith(mol, args, "+"); }, arithmetic_type);
+    session->intrinsics["-"] = Function("-", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_arith(mol, args, "-"); }, arithmetic_type);
+    session->intrinsics["*"] = Function("*", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_arith(mol, args, "*"); }, arithmetic_type);
+    session->intrinsics["/"] = Function("/", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_arith(mol, args, "/"); }, arithmetic_type);
+    session->intrinsics["%"] = Function("%", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_arith(mol, args, "%"); }, arithmetic_type);
     
     // modifying arithmetic
-    INTRINSICS["++"] = Function("++", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
-    INTRINSICS["eat"] = Function("eat", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
-    INTRINSICS["--"] = Function("--", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "--"); }, infer_first_type);
-    INTRINSICS["exercise"] = Function("exercise", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
-    INTRINSICS["+="] = Function("+=", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "+"); }, infer_first_type);
-    INTRINSICS["-="] = Function("-=", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compound_arith(mol, args, "-"); }, infer_first_type);
+    session->intrinsics["++"] = Function("++", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
+    session->intrinsics["eat"] = Function("eat", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
+    session->intrinsics["--"] = Function("--", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "--"); }, infer_first_type);
+    session->intrinsics["exercise"] = Function("exercise", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "++"); }, infer_first_type);
+    session->intrinsics["+="] = Function("+=", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "+"); }, infer_first_type);
+    session->intrinsics["-="] = Function("-=", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compound_arith(mol, args, "-"); }, infer_first_type);
     
     // comparison
-    INTRINSICS["=="] = Function("==", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, "=="); }, comparison_type);
-    INTRINSICS["!="] = Function("!=", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, "!="); }, comparison_type);
-    INTRINSICS[">"] = Function(">", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, ">"); }, comparison_type);
-    INTRINSICS[">="] = Function(">=", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, ">="); }, comparison_type);
-    INTRINSICS["<"] = Function("<", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, "<"); }, comparison_type);
-    INTRINSICS["<="] = Function("<=", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_compare(mol, args, "<="); }, comparison_type);
+    session->intrinsics["=="] = Function("==", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, "=="); }, comparison_type);
+    session->intrinsics["!="] = Function("!=", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, "!="); }, comparison_type);
+    session->intrinsics[">"] = Function(">", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, ">"); }, comparison_type);
+    session->intrinsics[">="] = Function(">=", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, ">="); }, comparison_type);
+    session->intrinsics["<"] = Function("<", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, "<"); }, comparison_type);
+    session->intrinsics["<="] = Function("<=", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_compare(mol, args, "<="); }, comparison_type);
     
     // boolean not
-    INTRINSICS["!"] = Function("!", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_not(mol, args); }, comparison_type);
+    session->intrinsics["!"] = Function("!", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_not(mol, args); }, comparison_type);
     
     // boolean and/or
-    INTRINSICS["&&"] = Function("&&", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_and(mol, args); }, comparison_type);
-    INTRINSICS["||"] = Function("||", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_or(mol, args); }, comparison_type);
+    session->intrinsics["&&"] = Function("&&", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_and(mol, args); }, comparison_type);
+    session->intrinsics["||"] = Function("||", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_or(mol, args); }, comparison_type);
     
     // def = declaration (requires type annotation)
-    INTRINSICS["def"] = Function("def", [](Molecule& mol, const std::vector<llvm::Value*>&) { return build_def(mol); }, def_type);
+    session->intrinsics["def"] = Function("def", [](Molecule& mol, const std::vector<StoredValue>&) { return build_def(mol); }, def_type);
     // = = reassignment only (variable must exist)
-    INTRINSICS["="] = Function("=", [](Molecule& mol, const std::vector<llvm::Value*>&) { return build_reassign(mol); }, reassign_type);
+    session->intrinsics["="] = Function("=", [](Molecule& mol, const std::vector<StoredValue>&) { return build_reassign(mol); }, reassign_type);
     
     // meow (always str) to overload later
-    INTRINSICS["meow"] = Function("meow", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_meow(mol, args); }, nil_type);
+    session->intrinsics["meow"] = Function("meow", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_meow(mol, args); }, nil_type);
+    
+    // meowf = meow its arguments, of any printable type, as one line
+    session->intrinsics["meowf"] = Function("meowf", [](Molecule& mol, const std::vector<StoredValue>&) { return build_meowf(mol); }, nil_type);
+    
+    // flush = write out what meow printed so far
+    session->intrinsics["flush"] = Function("flush", [](Molecule&, const std::vector<StoredValue>&) { emit_flush_output(); return IntrinsicResult(); }, nil_type);
     
     // return
-    INTRINSICS["return"] = Function("return", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_return(mol, args); }, infer_first_type);
+    session->intrinsics["return"] = Function("return", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_return(mol, args); }, infer_first_type);
     
     // typecasts
-    INTRINSICS["->S"] = Function("->S", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_conv(mol, args, "Str"); }, str_type);
-    INTRINSICS["->I"] = Function("->I", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_conv(mol, args, "Int"); }, int_type);
+    session->intrinsics["->S"] = Function("->S", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_conv(mol, args, STR_TYPE); }, str_type);
+    session->intrinsics["->I"] = Function("->I", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_conv(mol, args, INT_TYPE); }, int_type);
 
-    auto array_type = [](const std::vector<Particle>& args) -> std::string {
-        if (args.empty()) return "Array<Nil>";
-        return "Array<" + get_particle_type(args[0]) + ">";
+    auto array_type = [](const List& args) -> TypeRef {
+        if (args.empty()) return array_type_of(NIL_TYPE);
+        return array_type_of(get_particle_type(args[0]));
     };
-    INTRINSICS["array"] = Function("array", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array(mol, args); }, array_type);
-    INTRINSICS["len"] = Function("len", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_size(mol, args); }, int_type);
-    INTRINSICS["get"] = Function("get", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_element(mol, args, "get"); }, infer_array_type);
-    INTRINSICS["set"] = Function("set", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_element(mol, args, "set"); }, nil_type);
-
-    INTRINSICS["append"] = Function("append", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_memshift(mol, args, "append"); }, infer_array_self_type);
-    INTRINSICS["insert"] = Function("insert", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_memshift(mol, args, "insert"); }, infer_array_self_type);
-    INTRINSICS["remove"] = Function("remove", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_memshift(mol, args, "remove"); }, infer_array_self_type);
-    INTRINSICS["pop_back"] = Function("pop_back", [](Molecule& mol, const std::vector<llvm::Value*>& args) { return build_array_memshift(mol, args, "pop_back"); }, infer_element_type);
+    session->intrinsics["array"] = Function("array", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array(mol, args); }, array_type);
+    session->intrinsics["len"] = Function("len", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_size(mol, args); }, int_type);
+    session->intrinsics["get"] = Function("get", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_element(mol, args, "get"); }, infer_array_type);
+    session->intrinsics["set"] = Function("set", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_element(mol, args, "set"); }, nil_type);
+
+    session->intrinsics["append"] = Function("append", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_memshift(mol, args, "append"); }, infer_array_self_type);
+    session->intrinsics["insert"] = Function("insert", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_memshift(mol, args, "insert"); }, infer_array_self_type);
+    session->intrinsics["remove"] = Function("remove", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_memshift(mol, args, "remove"); }, infer_array_self_type);
+    session->intrinsics["pop_back"] = Function("pop_back", [](Molecule& mol, const std::vector<StoredValue>& args) { return build_array_memshift(mol, args, "pop_back"); }, infer_element_type);
+
+    // these never keep a reference to their arguments, so literal/conversion temporaries can die right after
+    for (const char* name : {"meow", "meowf", "->I", "len", "get"}) {
+        session->intrinsics[name].borrows_args = true;
+    }
 }
@@ -7,46 +7,59 @@
 #include <unordered_map>
 #include <cmath>
 
-// Result structure for intrinsic operations
-struct IntrinsicResult {
-    llvm::Value* value;
-};
+// Result of an intrinsic operation: an SSA rvalue, or an address for results
+// that name existing storage (def, =, append on a variable)
+typedef StoredValue IntrinsicResult;
+
+typedef std::function<IntrinsicResult(Molecule&, const std::vector<StoredValue>&)> IntrinsicBuilder;
 
-typedef std::function<IntrinsicResult(Molecule&, const std::vector<llvm::Value*>&)> IntrinsicBuilder;
+typedef std::function<TypeRef(const List&)> TypeInference;
 
 // Function class - wraps an intrinsic operation
 class Function {
 public: 
     std::string identifier;
-    std::string return_type;
-    std::vector<std::string> param_types;  // For overload matching
+    TypeRef signature = nullptr;  // fun/extern: Function type, for overload matching
     IntrinsicBuilder build;
-    std::function<std::string(const std::vector<Particle>&)> type_inference;
+    TypeInference type_inference;
+    bool borrows_args = false;  // Only reads its arguments; temporaries passed in die after the call
 
     Function() : identifier(), build(), type_inference() {}
-    Function(std::string id, std::string r, IntrinsicBuilder b) 
-     : identifier(id), return_type(r), build(b), type_inference([r](const std::vector<Particle>&){ return r; }) {}
+    Function(std::string id, TypeRef r, IntrinsicBuilder b) 
+     : identifier(id), build(b), type_inference([r](const List&){ return r; }) {}
     
-    Function(std::string id, IntrinsicBuilder b, std::function<std::string(const std::vector<Particle>&)> t)
-     : identifier(id), return_type(), build(b), type_inference(t) {}
+    Function(std::string id, IntrinsicBuilder b, TypeInference t)
+     : identifier(id), build(b), type_inference(t) {}
 
-    IntrinsicResult evaluate(Molecule& mol, const std::vector<llvm::Value*>& args);
+    IntrinsicResult evaluate(Molecule& mol, const std::vector<StoredValue>& args);
 };
 
+// Read a compiled value as an rvalue of the given type, loading only if it is an address
+llvm::Value* load_value(const StoredValue& v, llvm::Type* type);
+
+// The value to store into a variable, array element or struct field, or to return. Literal and ->S
+// temporaries are reused at their next evaluation (e.g. the next loop iteration), so a Str, array or
+// struct gets a heap copy of its own there; other types are stored as they are.
+llvm::Value* copy_stored_value(TypeRef type, llvm::Value* value);
+
 // Intrinsic builders
-IntrinsicResult build_arith(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& fn_name);
-IntrinsicResult build_compare(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& fn_name);
+IntrinsicResult build_arith(Molecule& mol, const std::vector<StoredValue>& args, const std::string& fn_name);
+IntrinsicResult build_compare(Molecule& mol, const std::vector<StoredValue>& args, const std::string& fn_name);
 IntrinsicResult build_def(Molecule& mol);
 IntrinsicResult build_reassign(Molecule& mol);
-IntrinsicResult build_meow(Molecule& mol, const std::vector<llvm::Value*>& args);
-IntrinsicResult build_conv(Molecule& mol, const std::vector<llvm::Value*>& args, const std::string& out_type);
-IntrinsicResult build_array(Molecule& mol, const std::vector<llvm::Value*>& args);
-IntrinsicResult build_return(Molecule& mol, const std::vector<llvm::Value*>& args);
+IntrinsicResult build_meow(Molecule& mol, const std::vector<StoredValue>& args);
+IntrinsicResult build_meowf(Molecule& mol);
+IntrinsicResult build_conv(Molecule& mol, const std::vector<StoredValue>& args, TypeRef out_type);
+IntrinsicResult build_array(Molecule& mol, const std::vector<StoredValue>& args);
+IntrinsicResult build_return(Molecule& mol, const std::vector<StoredValue>& args);
 
-// Global intrinsics map
-extern std::unordered_map<std::string, Function> INTRINSICS;
+// The Function a call molecule dispatches to (the overload for its argument types first, then the
+// intrinsic or fun of that name), or nullptr. Cached on the molecule: the type pass resolves every
+// call once, and codegen dispatches through the cached pointer.
+Function* resolve_call(Molecule& mol, const std::vector<TypeRef>& arg_types);
+Function* resolve_call(Molecule& mol);
 
-// Initialize intrinsics map
+// Register the intrinsics in the current session
 void init_intrinsics();
 
 #endif // INTRINSICS_HPP
@@ -0,0 +1,83 @@
+#include "jit.hpp"
+#include "backend.hpp"
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+
+std::unique_ptr<llvm::orc::LLLazyJIT> create_jit(int opt_level) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    llvm::Expected<std::unique_ptr<llvm::orc::LLLazyJIT>> jit = llvm::orc::LLLazyJITBuilder().create();
+    if (!jit) {
+        std::cerr << "Error: could not start JIT: " << llvm::toString(jit.takeError()) << std::endl;
+        return nullptr;
+    }
+
+    // Externs (puts, sprintf, malloc, C libraries...) come from the host process
+    llvm::orc::JITDylib& main_dylib = (*jit)->getMainJITDylib();
+    auto process_symbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        (*jit)->getDataLayout().getGlobalPrefix());
+    if (!process_symbols) {
+        std::cerr << "Error: could not load host symbols: " << llvm::toString(process_symbols.takeError()) << std::endl;
+        return nullptr;
+    }
+    main_dylib.addGenerator(std::move(*process_symbols));
+
+    // Optimize each lazily extracted function just before it is compiled, so
+    // code that never runs is never optimized either
+    if (opt_level > 0) {
+        (*jit)->getIRTransformLayer().setTransform(
+            [opt_level](llvm::orc::ThreadSafeModule partition, llvm::orc::MaterializationResponsibility&)
+                -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+                partition.withModuleDo([opt_level](llvm::Module& m) {
+                    optimize_module(m, nullptr, opt_level, false);
+                });
+                return std::move(partition);
+            });
+    }
+
+    return std::move(*jit);
+}
+
+bool add_module_to_jit(llvm::orc::LLLazyJIT& jit, std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context) {
+    module->setDataLayout(jit.getDataLayout());
+    llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
+    if (llvm::Error err = jit.addLazyIRModule(std::move(tsm))) {
+        std::cerr << "Error: could not add module to JIT: " << llvm::toString(std::move(err)) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int run_module(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context, int opt_level,
+               const std::vector<std::string>& objects) {
+    std::unique_ptr<llvm::orc::LLLazyJIT> jit = create_jit(opt_level);
+    if (!jit || !add_module_to_jit(*jit, std::move(module), std::move(context))) {
+        return 1;
+    }
+
+    for (const std::string& object : objects) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(object);
+        if (!buffer) {
+            std::cerr << "Error: could not open " << object << ": " << buffer.getError().message() << std::endl;
+            return 1;
+        }
+        if (llvm::Error err = jit->addObjectFile(std::move(*buffer))) {
+            std::cerr << "Error: could not load " << object << ": " << llvm::toString(std::move(err)) << std::endl;
+            return 1;
+        }
+    }
+
+    auto main_addr = jit->lookup("main");
+    if (!main_addr) {
+        std::cerr << "Error: " << llvm::toString(main_addr.takeError()) << std::endl;
+        return 1;
+    }
+
+    auto miaow_main = main_addr->toPtr<int (*)()>();
+    return miaow_main();
+}
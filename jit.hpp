@@ -0,0 +1,21 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "types.hpp"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+
+// Create a lazy JIT for the host. Externs resolve against the host process (libc included);
+// fun bodies are compiled, and optimized at -O<opt_level>, the first time they are called.
+// Returns nullptr if the JIT cannot be created.
+std::unique_ptr<llvm::orc::LLLazyJIT> create_jit(int opt_level);
+
+// Hand a module (and the context that owns it) to the JIT
+bool add_module_to_jit(llvm::orc::LLLazyJIT& jit, std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context);
+
+// JIT-compile the module in-process, together with any object files (e.g. --module output), and call its main.
+// Returns main's exit code, or 1 if the JIT fails.
+int run_module(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context, int opt_level,
+               const std::vector<std::string>& objects = {});
+
+#endif // JIT_HPP
@@ -1,123 +1,355 @@
-#include <fstream>
-#include <sstream>
 #include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "types.hpp"
 #include "intrinsics.hpp"
 #include "parser.hpp"
 #include "compiler.hpp"
+#include "checker.hpp"
 #include "preprocessor.hpp"
+#include "session.hpp"
+#include "backend.hpp"
+#include "jit.hpp"
+#include "repl.hpp"
+#include "report.hpp"
+#include "runtime.hpp"
 
 
 
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/TargetParser/Triple.h>
 
 // Global target flag
 bool target_wasm = false;
 
-int main(int argc, char** argv) {
-    // llvm globals
-    TheContext = std::make_unique<llvm::LLVMContext>();
-    TheModule = std::make_unique<llvm::Module>("miaow_module", *TheContext);
-    Builder = std::make_unique<llvm::IRBuilder<>>(*TheContext);
+// --unbuffered: meow prints through puts instead of the output buffer
+bool unbuffered_output = false;
 
-    // build miaow intrinsic functions
-    init_intrinsics();
-    
-    std::string filename = "hello.inf";
-    std::string output_file = "hello.ll";
-    
-    // Parse command line arguments
-    for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--wasm") == 0 || strcmp(argv[i], "-w") == 0) {
-            target_wasm = true;
-        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
-            output_file = argv[++i];
-        } else if (argv[i][0] != '-') {
-            filename = argv[i];
-        }
+// Write a module's interface next to its output (lib.o -> lib.mi). An unchanged interface is left
+// untouched, so build tools don't rebuild the importers of a module whose funs only changed inside.
+static bool write_interface(const std::string& output_file, const std::string& interface) {
+    llvm::SmallString<256> interface_path(output_file);
+    llvm::sys::path::replace_extension(interface_path, ".mi");
+    std::string path = interface_path.str().str();
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> existing = llvm::MemoryBuffer::getFile(path);
+    if (existing && (*existing)->getBuffer() == interface) {
+        return true;
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream out(path, EC, llvm::sys::fs::OF_Text);
+    if (EC) {
+        std::cerr << "Error: could not write " << path << ": " << EC.message() << "\n";
+        return false;
+    }
+    out << interface;
+    return true;
+}
+
+// How to build each input file, from the command line
+struct CompileOptions {
+    std::string output_file;  // Empty: named after the input
+    EmitKind emit_kind = EmitKind::LLVM_IR;
+    int opt_level = 0;
+    bool print_pipeline = false;
+    bool run_jit = false;
+    bool module = false;
+    unsigned codegen_threads = 1;  // Partitions optimized and lowered in parallel (--codegen-threads)
+    std::vector<std::string> link_inputs;  // Objects of --module builds to link or load with the program
+    TimeReport report;
+};
+
+// Serializes what compiles running in parallel print as a whole (time reports)
+static std::mutex output_mutex;
+
+// A compile that stops with an error still reports the phases it went through, up to the failing one
+static int failed(TimeReport& report) {
+    report.end(nullptr, nullptr);
+    std::lock_guard lock(output_mutex);
+    report.print();
+    return 1;
+}
+
+// Compile one file in a session of its own. Returns the exit code for it.
+static int compile_file(const std::string& filename, const CompileOptions& options) {
+    CompilerSession compiler("miaow_module");
+    TimeReport report = options.report;
+    EmitKind emit_kind = options.emit_kind;
+
+    // Default output: input name with the extension of the emitted kind
+    std::string output_file = options.output_file;
+    if (output_file.empty()) {
+        // Only the file name's extension is replaced (./dir/prog -> ./dir/prog.ll)
+        llvm::SmallString<256> path(filename);
+        llvm::sys::path::replace_extension(path, emit_extension(emit_kind));
+        output_file = path.str().str();
+        if (output_file == filename) output_file += ".out";
     }
     
     // Set target triple and data layout for WASM
     if (target_wasm) {
-        TheModule->setTargetTriple(llvm::Triple("wasm32-unknown-emscripten"));
-        TheModule->setDataLayout("e-m:e-p:32:32-p10:8:8-p20:8:8-i64:64-n32:64-S128-ni:1:10:20");
+        session->module->setTargetTriple(llvm::Triple("wasm32-unknown-emscripten"));
+        session->module->setDataLayout("e-m:e-p:32:32-p10:8:8-p20:8:8-i64:64-n32:64-S128-ni:1:10:20");
     }
-    
-    std::ifstream sourcefile(filename);
 
-    // read source
-    std::stringstream buffer;
-    buffer << sourcefile.rdbuf();
-    std::string source = buffer.str();
+    // Target machine for the module's triple (host unless --wasm); drives optimization
+    std::unique_ptr<llvm::TargetMachine> target_machine = create_target_machine(*session->module, options.opt_level);
     
-    // preprocess source (remove comments)
-    source = preprocess(source);
+    // read source (mapped into memory for large files)
+    report.begin("read");
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> sourcefile =
+        llvm::MemoryBuffer::getFile(filename, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!sourcefile) {
+        std::cerr << "Error: could not open " << filename << ": " << sourcefile.getError().message() << "\n";
+        return failed(report);
+    }
+    report.end(nullptr, nullptr);
+    
+    // preprocess source (comments, !define, !import)
+    report.begin("preprocess");
+    std::string source = preprocess(std::string_view((*sourcefile)->getBufferStart(), (*sourcefile)->getBufferSize()),
+                                    filename, session->line_map);
+    report.end(nullptr, nullptr);
     
     std::string_view source_view(source);
     
     // parse source
-    Molecule root = lexparse(source_view);
+    report.begin("parse");
+    int parse_errors = 0;
+    Molecule root = lexparse(source_view, parse_errors);
+    if (parse_errors > 0) {
+        return failed(report);
+    }
     Particle root_particle = Particle(root); // capture the overarching curly braces
+    report.end(&root_particle, nullptr);
 
-    // Pass 1: type checking
-    for (auto& cmd : root.atoms) {
-        get_particle_type(cmd);
+    // Pass 1: collect struct declarations first (needed for type checking)
+    report.begin("structs");
+    collect_struct_declarations(root_particle);
+    report.end(nullptr, nullptr);
+
+    // Pass 1.5: type checking
+    report.begin("typecheck");
+    if (typecheck(std::get<Molecule>(root_particle)) > 0) {
+        return failed(report);
     }
+    report.end(nullptr, nullptr);
 
-    // Pass 1.5: collect struct declarations first (needed for correct variable hoisting)
-    collect_struct_declarations(root_particle);
+    // Pass 2: compilation
+    report.begin("codegen");
 
-    std::unordered_map<std::string, std::string> all_vars;
-    
-    // Pass 2: variable hoisting
-    collect_variables(root_particle, all_vars);
-
-    // main this is where the curly braces go
-    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(*TheContext), false);
-    llvm::Function* MainFunc = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "main", TheModule.get());
-    llvm::BasicBlock* EntryBB = llvm::BasicBlock::Create(*TheContext, "entry", MainFunc);
-    Builder->SetInsertPoint(EntryBB);
-
-    // allocate the hosted variables
-    for (auto& [var_name, var_type] : all_vars) {
-        llvm::Type* llvm_type;
-        // For extern structs, use the actual struct type (not pointer)
-        if (struct_registry.count(var_type) && struct_registry[var_type].is_extern) {
-            llvm_type = struct_registry[var_type].llvm_type;
-        } else {
-            llvm_type = get_llvm_type(var_type);
+    Molecule& root_mol = std::get<Molecule>(root_particle);
+
+    if (options.module) {
+        if (!compile_module(root_mol)) {
+            return failed(report);
+        }
+    } else {
+        // main this is where the curly braces go; each def allocates its slot in the
+        // entry block of the function it's in
+        llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context), false);
+        llvm::Function* MainFunc = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "main", session->module.get());
+        llvm::BasicBlock* EntryBB = llvm::BasicBlock::Create(*session->context, "entry", MainFunc);
+        session->builder->SetInsertPoint(EntryBB);
+
+        for (size_t i = 1; i < root_mol.atoms.size(); i++) {
+            compile(root_mol.atoms[i]);
         }
-        llvm::AllocaInst* alloca = Builder->CreateAlloca(llvm_type, nullptr, var_name);
-        object_registry[var_name] = MemObject(var_type, alloca);
+
+        clear_temporaries();
+
+        // Return 0
+        session->builder->CreateRet(llvm::ConstantInt::get(*session->context, llvm::APInt(32, 0)));
+
+        // Whatever is still in the output buffer is written when main returns
+        flush_output_before_returns(MainFunc);
     }
+    report.end(nullptr, session->module.get());
+
+    // Verify module
+    report.begin("verify");
+    if (llvm::verifyModule(*session->module, &llvm::errs())) {
+        std::cerr << "Error: Module verification failed\n";
+        return failed(report);
+    }
+    report.end(nullptr, nullptr);
+
+    // --run: execute in-process instead of writing a file (optimization happens per function in the JIT)
+    if (options.run_jit) {
+        report.print();
+        return run_module(std::move(session->module), std::move(session->context), options.opt_level, options.link_inputs);
+    }
+
+    // --codegen-threads: partitions of the module are optimized and lowered to object code in parallel.
+    // Textual outputs (ll, bc, asm) are still produced from the whole module.
+    bool split = options.codegen_threads > 1 && target_machine
+        && (emit_kind == EmitKind::Object || emit_kind == EmitKind::Executable);
+
+    // Run the -O<n> pipeline before emission (per partition when split)
+    if (!split) {
+        report.begin("optimize");
+        optimize_module(*session->module, target_machine.get(), options.opt_level, options.print_pipeline);
+        report.end(nullptr, session->module.get());
+    }
+
+    // Write the requested output (textual IR, bitcode, assembly, object or executable)
+    report.begin("emit");
+    bool emitted = split
+        ? emit_module_split(*session->module, emit_kind, options.opt_level, options.print_pipeline,
+                            options.codegen_threads, output_file, options.link_inputs)
+        : emit_module(*session->module, target_machine.get(), emit_kind, output_file, options.link_inputs);
+    if (!emitted) {
+        return failed(report);
+    }
+    if (options.module && !write_interface(output_file, module_interface(root_mol, filename))) {
+        return failed(report);
+    }
+    report.end(nullptr, nullptr);
+
+    std::lock_guard lock(output_mutex);
+    report.print();
+    return 0;
+}
+
+// Parse a positive count (-j, --codegen-threads). Returns false if text isn't one.
+static bool parse_count(const char* text, unsigned& count) {
+    char* end;
+    long n = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || n < 1) {
+        return false;
+    }
+    count = n;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    CompileOptions options;
+    std::vector<std::string> filenames;
+    unsigned jobs = 1;
+    bool repl = false;
+    bool emit_given = false;
     
-    // Pass 3: compilation
-    Molecule& root_mol = std::get<Molecule>(root_particle);
-    
-    for (size_t i = 1; i < root_mol.atoms.size(); i++) {
-        compile(root_mol.atoms[i]);
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--wasm") == 0 || strcmp(argv[i], "-w") == 0) {
+            target_wasm = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            options.output_file = argv[++i];
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            if (strlen(argv[i]) != 3 || argv[i][2] < '0' || argv[i][2] > '3') {
+                std::cerr << "Error: unknown optimization level " << argv[i] << " (expected -O0 to -O3)\n";
+                return 1;
+            }
+            options.opt_level = argv[i][2] - '0';
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            // -j N or -jN: compile up to N files at once
+            const char* count = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            if (!parse_count(count, jobs)) {
+                std::cerr << "Error: -j expects a number of jobs, got '" << count << "'\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--codegen-threads") == 0) {
+            const char* count = i + 1 < argc ? argv[++i] : "";
+            if (!parse_count(count, options.codegen_threads)) {
+                std::cerr << "Error: --codegen-threads expects a number of threads, got '" << count << "'\n";
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--print-pipeline") == 0) {
+            options.print_pipeline = true;
+        } else if (strcmp(argv[i], "--unbuffered") == 0) {
+            unbuffered_output = true;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            options.run_jit = true;
+        } else if (strcmp(argv[i], "--repl") == 0) {
+            repl = true;
+        } else if (strcmp(argv[i], "--time-report") == 0) {
+            options.report = TimeReport(true);
+        } else if (strcmp(argv[i], "--time-report=json") == 0) {
+            options.report = TimeReport(true, true);
+        } else if (strcmp(argv[i], "--module") == 0) {
+            options.module = true;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            import_cache_dir = default_import_cache_dir();
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            import_cache_dir = argv[++i];
+        } else if (strncmp(argv[i], "--emit=", 7) == 0) {
+            if (!parse_emit_kind(argv[i] + 7, options.emit_kind)) {
+                std::cerr << "Error: unknown output kind " << argv[i] << " (expected obj, asm, bc, ll or exe)\n";
+                return 1;
+            }
+            emit_given = true;
+        } else if (argv[i][0] != '-' && std::string_view(argv[i]).ends_with(".o")) {
+            options.link_inputs.push_back(argv[i]);
+        } else if (argv[i][0] != '-') {
+            filenames.push_back(argv[i]);
+        }
+    }
+    if (filenames.empty()) {
+        filenames.push_back("hello.inf");
     }
 
-    // Return 0
-    Builder->CreateRet(llvm::ConstantInt::get(*TheContext, llvm::APInt(32, 0)));
+    if ((options.run_jit || repl) && target_wasm) {
+        std::cerr << "Error: --run and --repl execute on the host and cannot be combined with --wasm\n";
+        return 1;
+    }
 
-    // Verify module
-    if (llvm::verifyModule(*TheModule, &llvm::errs())) {
-        std::cerr << "Error: Module verification failed\n";
+    if (repl) {
+        return run_repl(options.opt_level);
+    }
+
+    if (options.module) {
+        // A module has no main, so it is built as an object unless asked otherwise
+        if (!emit_given) options.emit_kind = EmitKind::Object;
+        if (options.emit_kind == EmitKind::Executable || options.run_jit) {
+            std::cerr << "Error: a --module has no main, so it cannot be linked into an executable or run\n";
+            return 1;
+        }
+    }
+    if (!options.link_inputs.empty() && options.emit_kind != EmitKind::Executable && !options.run_jit) {
+        std::cerr << "Error: object files are only used with --emit=exe or --run\n";
         return 1;
     }
 
-    // Print to file
-    std::error_code EC;
-    llvm::raw_fd_ostream dest(output_file, EC, llvm::sys::fs::OF_None);
-    if (EC) {
-        std::cerr << "Could not open file: " << EC.message();
+    if (filenames.size() == 1) {
+        return compile_file(filenames[0], options);
+    }
+
+    // Several inputs: each is compiled on its own, into an output named after it
+    if (!options.output_file.empty() || options.run_jit) {
+        std::cerr << "Error: -o and --run take a single input file\n";
         return 1;
     }
-    TheModule->print(dest, nullptr);
-    
-    return 0;
-}
\ No newline at end of file
+
+    // Worker threads take the next file until none are left; each file gets its own session
+    std::atomic<size_t> next{0};
+    std::atomic<bool> any_failed{false};
+    auto worker = [&]() {
+        for (size_t i = next++; i < filenames.size(); i = next++) {
+            CompileOptions file_options = options;
+            file_options.report.set_file(filenames[i]);
+            if (compile_file(filenames[i], file_options) != 0) {
+                any_failed = true;
+            }
+        }
+    };
+
+    if (jobs > 1) {
+        share_tables_between_threads();
+    }
+    // getrusage only measures the whole process, which the other workers share
+    options.report.set_shared_process(std::min<size_t>(jobs, filenames.size()) > 1);
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < std::min<size_t>(jobs, filenames.size()); t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return any_failed ? 1 : 0;
+}
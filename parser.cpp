@@ -1,124 +1,189 @@
 #include "parser.hpp"
+#include "session.hpp"
 
-Molecule lexparse(std::string_view view) {
-    auto first_paren = view.find_first_of("([{");
-    if (first_paren == std::string_view::npos) {
-        return Molecule{};
+static bool is_whitespace(char c) {
+    return std::string_view(WHITESPACE).find(c) != std::string_view::npos;
+}
+
+static bool is_open(char c) {
+    return c == '(' || c == '[' || c == '{';
+}
+
+static bool is_close(char c) {
+    return c == ')' || c == ']' || c == '}';
+}
+
+void Lexer::skip_whitespace() {
+    while (pos < source.size() && is_whitespace(source[pos])) {
+        if (source[pos] == '\n') {
+            line++;
+            line_start = pos + 1;
+        }
+        pos++;
+    }
+}
+
+Token Lexer::next() {
+    skip_whitespace();
+
+    Token tok;
+    tok.offset = pos;
+    tok.line = line;
+    tok.col = pos - line_start + 1;
+    if (pos >= source.size()) {
+        return tok;
     }
-    
-    bool eval = true;
-    bool is_block = (view[first_paren] == '{');
-    bool is_array = (view[first_paren] == '[');
 
-    view = view.substr(first_paren + 1);
+    char c = source[pos];
+    size_t end = pos + 1;
+    if (is_open(c)) {
+        tok.kind = TokenKind::Open;
+    } else if (is_close(c)) {
+        tok.kind = TokenKind::Close;
+    } else if (c == '"') {
+        // String literal, quotes included; may span lines
+        tok.kind = TokenKind::String;
+        size_t close_quote = source.find('"', pos + 1);
+        end = (close_quote == std::string_view::npos) ? source.size() : close_quote + 1;
+        for (size_t p = pos + 1; p < end; p++) {
+            if (source[p] == '\n') {
+                line++;
+                line_start = p + 1;
+            }
+        }
+    } else {
+        // Word: runs until whitespace or a bracket
+        tok.kind = TokenKind::Word;
+        while (end < source.size() && !is_whitespace(source[end]) && !is_open(source[end]) && !is_close(source[end])) {
+            end++;
+        }
+    }
 
-    Molecule molecule({}, eval);
+    tok.text = source.substr(pos, end - pos);
+    pos = end;
+    return tok;
+}
 
-    if (is_block) {
-        molecule.add_atom("block");
-    } else if (is_array) {
-        molecule.add_atom("array");
+// Recursive descent over the token stream; each token is looked at once
+class Parser {
+public:
+    explicit Parser(std::string_view source) : lexer(source) {
+        current = lexer.next();
     }
 
-    bool more_words = true;
-    while (more_words) {
-        size_t word_begin = view.find_first_not_of(WHITESPACE);
+    Molecule parse_root();
+
+    int errors = 0;
 
-        if (word_begin == std::string::npos) {
-            more_words = false;
-            break;
+private:
+    Lexer lexer;
+    Token current;
+    // Children of every molecule still open, innermost last; each is moved
+    // into the AST arena as one run when its molecule closes
+    std::vector<Particle> pending;
+
+    void advance() { current = lexer.next(); }
+    Molecule parse_molecule();
+    void add_atom(std::string_view text, const Token& tok);
+    void error(const Token& tok, const std::string& message);
+};
+
+void Parser::error(const Token& tok, const std::string& message) {
+    std::cerr << "Error: " << session->line_map.locate(tok.line) << ":" << tok.col << ": " << message << std::endl;
+    errors++;
+}
+
+void Parser::add_atom(std::string_view text, const Token& tok) {
+    Atom atom(text);
+    atom.line = tok.line;
+    atom.col = tok.col;
+    pending.push_back(atom);
+}
+
+Molecule Parser::parse_root() {
+    // Anything before the first bracket is ignored
+    while (current.kind != TokenKind::Open) {
+        if (current.kind == TokenKind::End) {
+            return Molecule{};
         }
-        if (view[word_begin] == ')' || view[word_begin] == ']' || view[word_begin] == '}') {
-            more_words = false;
-        } else if (view[word_begin] == '(' || view[word_begin] == '[' || view[word_begin] == '{') {
-            view = view.substr(word_begin);
-
-            int layers = 0;
-            size_t word_end = std::string_view::npos;
-            for (size_t p = 0; p < view.length(); p++) {
-                if (view[p] == '(' || view[p] == '[' || view[p] == '{') {
-                    layers++;
-                } else if (view [p] == ')' || view[p] == ']' || view[p] == '}') {
-                    layers--;
-                }
+        advance();
+    }
+    return parse_molecule();
+}
+
+Molecule Parser::parse_molecule() {
+    Token open = current;
+    advance();
+
+    Molecule molecule({}, true);
+    molecule.line = open.line;
+    molecule.col = open.col;
+    size_t first_child = pending.size();
 
-                if (layers == 0) {
-                    word_end = p;
-                    break;
+    if (open.text[0] == '{') {
+        add_atom("block", open);
+    } else if (open.text[0] == '[') {
+        add_atom("array", open);
+    }
+
+    while (true) {
+        switch (current.kind) {
+            case TokenKind::End:
+                error(open, std::string("unclosed '") + open.text[0] + "'");
+                molecule.atoms = session->ast_arena.store(pending, first_child);
+                return molecule;
+
+            case TokenKind::Close: {
+                char expected = open.text[0] == '(' ? ')' : open.text[0] == '[' ? ']' : '}';
+                if (current.text[0] != expected) {
+                    // Closed anyway, so the rest of the source still parses
+                    error(current, std::string("expected '") + expected + "' to close '" + open.text[0] + "' at " +
+                          session->line_map.locate(open.line) + ":" + std::to_string(open.col));
                 }
+                advance();
+                molecule.atoms = session->ast_arena.store(pending, first_child);
+                return molecule;
             }
-            if (word_end == std::string_view::npos) {
+
+            case TokenKind::Open:
+                pending.push_back(parse_molecule());
                 break;
-            }
 
-            if (view[word_begin] == '(') {
-                std::string_view sub_molecule = view.substr(0, word_end + 1);
-                
-                molecule.add_molecule(lexparse(sub_molecule));
-                view = view.substr(word_end+1);
-            } else if (view[word_begin] == '[') {
-                std::string_view sub_molecule = view.substr(0, word_end + 1);
-                
-                molecule.add_molecule(lexparse(sub_molecule));
-                view = view.substr(word_end+1);
-            } else if (view[word_begin] == '{') {
-                std::string_view sub_molecule = view.substr(0, word_end + 1);
-                
-                molecule.add_molecule(lexparse(sub_molecule));
-                view = view.substr(word_end+1);
-            }
-        } else if (view[word_begin] == '\"') {
-            int end_quote = view.substr(1).find_first_of("\"");
-            molecule.add_atom(std::string(view.substr(0,end_quote+2)));
-            view = view.substr(end_quote+3);
-        } else {
-            // Check for Type:(molecule) syntax - word ending with : followed by (
-            size_t rel_end = view.substr(word_begin).find_first_of(WHITESPACE "([{");
-            size_t word_end = (rel_end == std::string::npos) ? view.size() : word_begin + rel_end;
-            std::string word(view.substr(word_begin, word_end - word_begin));
-            
-            if (word.back() == ')' || word.back() == ']' || word.back() == '}') {
-                more_words = false;
-                word.pop_back();
-            }
-            
-            // Handle Type:(molecule) or Type:[array] - type prefix on sub-expression
-            if (!word.empty() && word.back() == ':' && word_end < view.size() && (view[word_end] == '(' || view[word_end] == '[')) {
-                std::string type_prefix = word.substr(0, word.size() - 1);  // Remove trailing :
-                view = view.substr(word_end);  // Start from the ( or [
-                
-                // Find matching closing paren/bracket
-                int layers = 0;
-                size_t paren_end = std::string_view::npos;
-                for (size_t p = 0; p < view.length(); p++) {
-                    if (view[p] == '(' || view[p] == '[' || view[p] == '{') {
-                        layers++;
-                    } else if (view[p] == ')' || view[p] == ']' || view[p] == '}') {
-                        layers--;
-                    }
-                    if (layers == 0) {
-                        paren_end = p;
-                        break;
-                    }
-                }
-                if (paren_end != std::string_view::npos) {
-                    std::string_view sub_molecule = view.substr(0, paren_end + 1);
-                    Molecule* added = molecule.add_molecule(lexparse(sub_molecule));
-                    if (added) {
-                        added->type = type_prefix;  // Attach type to the molecule
-                    }
-                    view = view.substr(paren_end + 1);
+            case TokenKind::String: {
+                if (current.text.size() < 2 || current.text.back() != '"') {
+                    error(current, "unterminated string literal");
+                    add_atom(std::string(current.text) + '"', current);
+                } else {
+                    add_atom(current.text, current);
                 }
-            } else {
-                molecule.add_atom(word);
-                if (word_end < view.size()) {
-                    view = view.substr(word_end+1);
+                advance();
+                break;
+            }
+
+            case TokenKind::Word: {
+                Token word = current;
+                advance();
+
+                // Type:(molecule) or Type:[array] - type prefix directly on a sub-expression
+                bool typed = word.text.size() > 1 && word.text.back() == ':'
+                    && current.kind == TokenKind::Open && current.text[0] != '{'
+                    && current.offset == word.offset + word.text.size();
+                if (typed) {
+                    Molecule sub = parse_molecule();
+                    sub.type = lookup_type(word.text.substr(0, word.text.size() - 1));
+                    pending.push_back(sub);
                 } else {
-                    more_words = false;
+                    add_atom(word.text, word);
                 }
+                break;
             }
         }
     }
+}
 
-    return molecule;
+Molecule lexparse(std::string_view view, int& errors) {
+    Parser parser(view);
+    Molecule root = parser.parse_root();
+    errors = parser.errors;
+    return root;
 }
@@ -3,7 +3,36 @@
 
 #include "types.hpp"
 
-// Parse source code into a Molecule AST
-Molecule lexparse(std::string_view view);
+enum class TokenKind { Open, Close, Word, String, End };
+
+// A token; text points into the source being lexed
+struct Token {
+    TokenKind kind = TokenKind::End;
+    std::string_view text;
+    size_t offset = 0;
+    int line = 1;
+    int col = 1;
+};
+
+// Splits source into tokens in one forward pass, tracking line/column
+class Lexer {
+public:
+    explicit Lexer(std::string_view source) : source(source) {}
+
+    // Next token, or an End token once the source is exhausted
+    Token next();
+
+private:
+    std::string_view source;
+    size_t pos = 0;
+    int line = 1;
+    size_t line_start = 0;
+
+    void skip_whitespace();
+};
+
+// Parse source code into a Molecule AST. Sets errors to the number of syntax errors reported;
+// the AST is still whole then (unclosed brackets are closed at the end), but shouldn't be compiled.
+Molecule lexparse(std::string_view view, int& errors);
 
 #endif // PARSER_HPP
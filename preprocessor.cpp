@@ -1,288 +1,429 @@
 #include "preprocessor.hpp"
 #include <unordered_map>
 #include <unordered_set>
-#include <sstream>
-#include <fstream>
 #include <iostream>
-#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cinttypes>
 
-// Step 1: Remove comments (;)
-static std::string remove_comments(const std::string& source) {
-    std::string result;
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+std::string import_cache_dir;
+
+std::string default_import_cache_dir() {
+    llvm::SmallString<128> dir;
+    if (!llvm::sys::path::cache_directory(dir)) return "";
+    llvm::sys::path::append(dir, "miaow");
+    return std::string(dir);
+}
+
+std::string LineMap::locate(int output_line) const {
+    auto entry = std::upper_bound(entries.begin(), entries.end(), output_line,
+        [](int line, const Entry& e) { return line < e.output_line; });
+    if (entry == entries.begin()) return std::to_string(output_line);
+    --entry;
+    return files[entry->file] + ":" + std::to_string(entry->line + output_line - entry->output_line);
+}
+
+void LineMap::clear() {
+    files.clear();
+    entries.clear();
+}
+
+// !define names are looked up straight from the source text
+struct ViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+typedef std::unordered_map<std::string, std::string, ViewHash, std::equal_to<>> Defines;
+
+static bool is_ident_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool is_ident_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static size_t skip_blanks(std::string_view line, size_t pos) {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+    return pos;
+}
+
+// The argument of a directive: from pos (after blanks) to a comment or the end of the line
+static std::string_view directive_argument(std::string_view line, size_t pos) {
+    pos = skip_blanks(line, pos);
     bool in_string = false;
-    
-    for (size_t i = 0; i < source.size(); i++) {
-        char c = source[i];
-        
-        if (c == '"') {
-            in_string = !in_string;
-            result += c;
-        } else if (c == ';' && !in_string) {
-            // Skip until end of line
-            while (i < source.size() && source[i] != '\n') {
-                i++;
-            }
-            // Keep the newline to preserve line numbers
-            if (i < source.size()) {
-                result += '\n';
-            }
-        } else {
-            result += c;
-        }
+    size_t end = pos;
+    for (; end < line.size(); end++) {
+        if (line[end] == '"') in_string = !in_string;
+        else if (line[end] == ';' && !in_string) break;
     }
-    return result;
+    return line.substr(pos, end - pos);
 }
 
+// Version line of a cache entry; bump it whenever the preprocessor's output changes
+static const char* CACHE_MAGIC = "miaow-import-cache 1\n";
 
-static std::string expand_defines(const std::string& source) {
-    std::unordered_map<std::string, std::string> defines;
-    std::string result;
-    std::istringstream stream(source);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        size_t start = line.find_first_not_of(" \t");
-        if (start != std::string::npos && line.substr(start, 7) == "!define") {
+static uint64_t content_hash(std::string_view text) {
+    return llvm::xxHash64(llvm::StringRef(text.data(), text.size()));
+}
 
-            size_t pos = start + 7;
+static std::string hex(uint64_t hash) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016" PRIx64, hash);
+    return buf;
+}
 
-            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+// One import's preprocessed output as stored in the cache. files[0] is the import itself,
+// the rest are the files it pulled in (transitively), in import order.
+struct CachedImport {
+    std::vector<std::pair<uint64_t, std::string>> files;  // Content hash, name
+    std::vector<LineMap::Entry> entries;  // output_line counts from 0 at the start of text, file indexes files
+    int newlines = 0;
+    std::string_view text;
 
-            size_t name_start = pos;
-            while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t') pos++;
-            std::string name = line.substr(name_start, pos - name_start);
+    // Format: the magic line, "<n>" then n "<hash> <name>" lines, "<n>" then n "<output_line> <file> <line>" lines,
+    // "<newlines> <size>", then size bytes of text
+    bool parse(std::string_view data);
+};
 
-            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+// Cursor over the text header of a cache entry
+struct CacheReader {
+    std::string_view data;
 
-            std::string value = line.substr(pos);
-            defines[name] = value;
-            result += '\n'; 
-        } else {
-            result += line + '\n';
-        }
+    bool number(uint64_t& value, int base = 10) {
+        size_t start = data.find_first_not_of(' ');
+        if (start == std::string_view::npos) return false;
+        auto [end, error] = std::from_chars(data.data() + start, data.data() + data.size(), value, base);
+        if (error != std::errc()) return false;
+        data.remove_prefix(end - data.data());
+        return true;
     }
-    
 
-    std::string expanded;
-    bool in_string = false;
-    
-    for (size_t i = 0; i < result.size(); i++) {
-        char c = result[i];
-        
-        if (c == '"') {
-            in_string = !in_string;
-            expanded += c;
-        } else if (!in_string && (std::isalpha(c) || c == '_')) {
-            size_t start = i;
-            while (i < result.size() && (std::isalnum(result[i]) || result[i] == '_')) {
-                i++;
-            }
-            std::string ident = result.substr(start, i - start);
-            i--;
-            
-            if (defines.count(ident)) {
-                expanded += defines[ident];
-            } else {
-                expanded += ident;
-            }
-        } else {
-            expanded += c;
-        }
+    bool rest_of_line(std::string_view& line) {
+        size_t eol = data.find('\n');
+        if (eol == std::string_view::npos) return false;
+        line = data.substr(0, eol);
+        if (!line.empty() && line[0] == ' ') line.remove_prefix(1);
+        data.remove_prefix(eol + 1);
+        return true;
     }
-    
-    return expanded;
-}
+};
 
-// Preprocess a single file (comments + defines) in isolation
-static std::string preprocess_single(const std::string& source) {
-    std::string result = source;
-    result = remove_comments(result);
-    result = expand_defines(result);
-    return result;
-}
+bool CachedImport::parse(std::string_view data) {
+    if (data.substr(0, strlen(CACHE_MAGIC)) != CACHE_MAGIC) return false;
+    CacheReader in{data.substr(strlen(CACHE_MAGIC))};
+    std::string_view line;
 
-// Read a file and return its contents
-static std::string read_file(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open import file: " << filename << std::endl;
-        return "";
+    uint64_t count;
+    if (!in.number(count) || !in.rest_of_line(line)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t hash;
+        if (!in.number(hash, 16) || !in.rest_of_line(line)) return false;
+        files.emplace_back(hash, std::string(line));
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+
+    if (!in.number(count) || !in.rest_of_line(line)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t output_line, file, source_line;
+        if (!in.number(output_line) || !in.number(file) || !in.number(source_line) || !in.rest_of_line(line)) return false;
+        if (file >= files.size()) return false;
+        entries.push_back({(int)output_line, (int)file, (int)source_line});
+    }
+
+    uint64_t lines, size;
+    if (!in.number(lines) || !in.number(size) || !in.rest_of_line(line)) return false;
+    if (in.data.size() != size) return false;
+    newlines = lines;
+    text = in.data;
+    return true;
 }
 
-// Strip the outermost {} block from source, returning just the contents
-static std::string strip_outer_block(const std::string& source) {
-    // Find the first {
-    size_t open_brace = source.find('{');
-    if (open_brace == std::string::npos) {
-        return source; // No block, return as-is
+class Preprocessor {
+public:
+    std::string out;
+
+    explicit Preprocessor(LineMap& map) : map(map), file_hashes(map.files.size()) {}
+
+    // Stream one file into out. An imported file only contributes the inside of its outer {} block;
+    // !import lines before a file's outer block are spliced in right after its opening brace.
+    void run(std::string_view text, int file, bool is_import);
+
+private:
+    LineMap& map;
+    std::unordered_set<std::string> imported;  // Each file is imported at most once (also breaks cycles)
+    std::vector<uint64_t> file_hashes;  // Content hash of each imported file, by line map index
+    int out_line = 1;
+    int mapped_line = 0;  // Last output line checked against the line map
+    int skipped_imports = 0;  // Imports left out because they were already imported, or could not be read
+
+    void newline() {
+        out += '\n';
+        out_line++;
     }
-    
-    // Find the matching closing }
-    int depth = 0;
-    size_t close_brace = std::string::npos;
-    bool in_string = false;
-    
-    for (size_t i = open_brace; i < source.size(); i++) {
-        char c = source[i];
-        if (c == '"') {
-            in_string = !in_string;
-        } else if (!in_string) {
-            if (c == '{') depth++;
-            else if (c == '}') {
-                depth--;
-                if (depth == 0) {
-                    close_brace = i;
-                    break;
-                }
+
+    // Append text (no newlines) taken from `line` of `file`
+    void emit(std::string_view text, int file, int line) {
+        if (text.empty()) return;
+        if (mapped_line != out_line) {
+            mapped_line = out_line;
+            const LineMap::Entry* last = map.entries.empty() ? nullptr : &map.entries.back();
+            if (!last || last->file != file || last->line + (out_line - last->output_line) != line) {
+                map.entries.push_back({out_line, file, line});
             }
         }
+        out.append(text);
     }
-    
-    if (close_brace == std::string::npos) {
-        return source; // Unmatched brace, return as-is
+
+    void import(std::string_view name);
+
+    int add_file(const std::string& filename, uint64_t hash) {
+        map.files.push_back(filename);
+        file_hashes.push_back(hash);
+        return map.files.size() - 1;
+    }
+
+    bool splice_cached(const std::string& path, const std::string& filename, uint64_t hash);
+    void write_cache(const std::string& path, size_t out_start, int line_start, size_t entries_start, size_t files_start);
+};
+
+void Preprocessor::import(std::string_view name) {
+    // "lib" and "lib.inf" both name lib.inf; module interfaces are named in full ("lib.mi")
+    std::string filename(name);
+    if (!filename.ends_with(".inf") && !filename.ends_with(".mi")) {
+        filename += ".inf";
+    }
+    if (!imported.insert(filename).second) {
+        skipped_imports++;
+        return;
+    }
+
+    // MemoryBuffer maps the file into memory rather than reading it when that is cheaper
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+        llvm::MemoryBuffer::getFile(filename, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer) {
+        std::cerr << "Error: Could not open import file: " << filename << std::endl;
+        skipped_imports++;
+        return;
+    }
+    std::string_view text((*buffer)->getBufferStart(), (*buffer)->getBufferSize());
+
+    if (import_cache_dir.empty()) {
+        run(text, add_file(filename, 0), true);
+        return;
+    }
+
+    uint64_t hash = content_hash(text);
+    std::string cache_path = import_cache_dir + "/" + hex(hash) + ".inf.cache";
+    if (splice_cached(cache_path, filename, hash)) {
+        return;
+    }
+
+    size_t out_start = out.size();
+    int line_start = out_line;
+    size_t entries_start = map.entries.size();
+    size_t files_start = map.files.size();
+    int skipped_before = skipped_imports;
+    run(text, add_file(filename, hash), true);
+
+    // An import that left out one of its own imports depends on what came before it, so it is not cached
+    if (skipped_imports == skipped_before) {
+        write_cache(cache_path, out_start, line_start, entries_start, files_start);
     }
-    
-    // Return content between braces (excluding the braces themselves)
-    return source.substr(open_brace + 1, close_brace - open_brace - 1);
 }
 
-// Collect all !import directives that appear before the main {} block
-static void collect_imports_before_block(const std::string& source, 
-                                         std::vector<std::string>& import_names,
-                                         std::string& remaining) {
-    std::istringstream stream(source);
-    std::string line;
-    bool found_block = false;
-    std::string before_block;
-    std::string after_imports;
-    
-    while (std::getline(stream, line)) {
-        size_t start = line.find_first_not_of(" \t");
-        
-        // Check if this line starts the main block
-        if (!found_block && start != std::string::npos && line[start] == '{') {
-            found_block = true;
-            // Include this line and everything after in remaining
-            after_imports += line + '\n';
-            while (std::getline(stream, line)) {
-                after_imports += line + '\n';
-            }
-            break;
-        }
-        
-        // Check for !import before block
-        if (!found_block && start != std::string::npos && line.substr(start, 7) == "!import") {
-            size_t pos = start + 7;
-            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
-            size_t end = line.find_last_not_of(" \t\r\n");
-            std::string import_name = line.substr(pos, end - pos + 1);
-            import_names.push_back(import_name);
-            before_block += '\n'; // Preserve line numbers
-        } else {
-            before_block += line + '\n';
+bool Preprocessor::splice_cached(const std::string& path, const std::string& filename, uint64_t hash) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+        llvm::MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer) return false;
+
+    CachedImport cached;
+    if (!cached.parse(std::string_view((*buffer)->getBufferStart(), (*buffer)->getBufferSize()))) return false;
+    if (cached.files.empty() || cached.files[0].first != hash || cached.files[0].second != filename) return false;
+
+    // Every transitive import must be unchanged, and not already spliced in elsewhere
+    for (size_t i = 1; i < cached.files.size(); i++) {
+        const auto& [file_hash, name] = cached.files[i];
+        if (imported.count(name)) return false;
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> dependency =
+            llvm::MemoryBuffer::getFile(name, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+        if (!dependency) return false;
+        if (content_hash(std::string_view((*dependency)->getBufferStart(), (*dependency)->getBufferSize())) != file_hash) {
+            return false;
         }
     }
-    
-    remaining = before_block + after_imports;
+
+    int files_start = map.files.size();
+    for (const auto& [file_hash, name] : cached.files) {
+        imported.insert(name);
+        add_file(name, file_hash);
+    }
+    for (const LineMap::Entry& entry : cached.entries) {
+        map.entries.push_back({out_line + entry.output_line, files_start + entry.file, entry.line});
+    }
+    out.append(cached.text);
+    out_line += cached.newlines;
+    if (!cached.text.empty() && cached.text.back() != '\n') {
+        mapped_line = out_line;
+    }
+    return true;
 }
 
-// Process imports: imports before {} get their contents inserted at start of {}
-static std::string process_imports(const std::string& source, std::unordered_set<std::string>& imported) {
-    // First, collect imports that appear before the main {} block
-    std::vector<std::string> early_imports;
-    std::string remaining;
-    collect_imports_before_block(source, early_imports, remaining);
-    
-    // Process early imports - strip their {} and collect content
-    std::string imported_content;
-    for (const std::string& import_name : early_imports) {
-        std::string filename = import_name;
-        if (filename.size() < 4 || filename.substr(filename.size() - 4) != ".inf") {
-            filename += ".inf";
-        }
-        
-        if (imported.count(filename)) {
-            continue; // Skip circular imports
-        }
-        imported.insert(filename);
-        
-        std::string imported_source = read_file(filename);
-        if (!imported_source.empty()) {
-            // Recursively process imports in the imported file
-            std::string with_imports = process_imports(imported_source, imported);
-            // Preprocess in isolation
-            std::string preprocessed = preprocess_single(with_imports);
-            // Strip the outer {} block
-            std::string content = strip_outer_block(preprocessed);
-            imported_content += content + '\n';
-        }
+void Preprocessor::write_cache(const std::string& path, size_t out_start, int line_start,
+                               size_t entries_start, size_t files_start) {
+    std::string header = CACHE_MAGIC;
+    header += std::to_string(map.files.size() - files_start) + "\n";
+    for (size_t i = files_start; i < map.files.size(); i++) {
+        header += hex(file_hashes[i]) + " " + map.files[i] + "\n";
     }
-    
-    // Now inject the imported content at the start of the main {} block
-    std::string result;
-    if (!imported_content.empty()) {
-        size_t open_brace = remaining.find('{');
-        if (open_brace != std::string::npos) {
-            result = remaining.substr(0, open_brace + 1) + '\n' + imported_content + remaining.substr(open_brace + 1);
-        } else {
-            result = remaining;
+    header += std::to_string(map.entries.size() - entries_start) + "\n";
+    for (size_t i = entries_start; i < map.entries.size(); i++) {
+        const LineMap::Entry& entry = map.entries[i];
+        header += std::to_string(entry.output_line - line_start) + " " + std::to_string(entry.file - files_start) +
+                  " " + std::to_string(entry.line) + "\n";
+    }
+    header += std::to_string(out_line - line_start) + " " + std::to_string(out.size() - out_start) + "\n";
+
+    // Write to a unique temporary and rename it into place, so concurrent compiles never see half an entry.
+    // The cache is only an optimization: if any of this fails the entry is simply not written.
+    if (llvm::sys::fs::create_directories(import_cache_dir)) return;
+    int fd;
+    llvm::SmallString<128> temp_path;
+    if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, temp_path)) return;
+    {
+        llvm::raw_fd_ostream stream(fd, /*shouldClose=*/true);
+        stream << header;
+        stream.write(out.data() + out_start, out.size() - out_start);
+        stream.close();
+        if (stream.has_error()) {
+            stream.clear_error();
+            llvm::sys::fs::remove(temp_path);
+            return;
         }
-    } else {
-        result = remaining;
     }
-    
-    // Now process any !import directives that appear inside the {} block
-    std::string final_result;
-    std::istringstream stream(result);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        size_t start = line.find_first_not_of(" \t");
-        if (start != std::string::npos && line.substr(start, 7) == "!import") {
-            size_t pos = start + 7;
-            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
-            size_t end = line.find_last_not_of(" \t\r\n");
-            std::string import_name = line.substr(pos, end - pos + 1);
-            
-            std::string filename = import_name;
-            if (filename.size() < 4 || filename.substr(filename.size() - 4) != ".inf") {
-                filename += ".inf";
-            }
-            
-            if (imported.count(filename)) {
-                final_result += '\n';
-                continue;
+    if (llvm::sys::fs::rename(temp_path, path)) {
+        llvm::sys::fs::remove(temp_path);
+    }
+}
+
+void Preprocessor::run(std::string_view text, int file, bool is_import) {
+    Defines defines;  // A file's !defines only apply to the rest of that file
+    std::vector<std::string> early_imports;
+    bool in_block = false;  // Inside the file's outer {} block
+    bool in_string = false;
+    bool emitting = !is_import;
+    int depth = 0;  // Nesting inside an imported file's outer block
+
+    size_t pos = 0;
+    for (int line = 1; pos < text.size(); line++) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view l = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        size_t start = in_string ? std::string_view::npos : l.find_first_not_of(" \t");
+        if (start != std::string_view::npos && l.compare(start, 7, "!define") == 0) {
+            size_t name_start = skip_blanks(l, start + 7);
+            size_t name_end = name_start;
+            while (name_end < l.size() && l[name_end] != ' ' && l[name_end] != '\t') name_end++;
+            defines.insert_or_assign(std::string(l.substr(name_start, name_end - name_start)),
+                                     std::string(directive_argument(l, name_end)));
+        } else if (start != std::string_view::npos && l.compare(start, 7, "!import") == 0) {
+            std::string_view name = directive_argument(l, start + 7);
+            while (!name.empty() && (name.back() == ' ' || name.back() == '\t' || name.back() == '\r')) {
+                name.remove_suffix(1);
             }
-            imported.insert(filename);
-            
-            std::string imported_source = read_file(filename);
-            if (!imported_source.empty()) {
-                std::string with_imports = process_imports(imported_source, imported);
-                std::string preprocessed = preprocess_single(with_imports);
-                // For inline imports, strip outer block too
-                std::string content = strip_outer_block(preprocessed);
-                final_result += content + '\n';
+            if (!in_block) {
+                early_imports.emplace_back(name);
+            } else if (emitting) {
+                import(name);
+                newline();
             }
-            final_result += '\n';
         } else {
-            final_result += line + '\n';
+            size_t span = 0;  // Start of the text not yet emitted
+            auto flush = [&](size_t end) {
+                if (emitting) emit(l.substr(span, end - span), file, line);
+                span = end;
+            };
+
+            size_t i = 0;
+            while (i < l.size()) {
+                char c = l[i];
+                if (in_string) {
+                    size_t close = l.find('"', i);
+                    if (close == std::string_view::npos) {
+                        i = l.size();
+                    } else {
+                        in_string = false;
+                        i = close + 1;
+                    }
+                } else if (c == '"') {
+                    in_string = true;
+                    i++;
+                } else if (c == ';') {
+                    // Comment to the end of the line; the newline stays to keep line numbers
+                    break;
+                } else if (is_ident_start(c) && !defines.empty()) {
+                    size_t end = i + 1;
+                    while (end < l.size() && is_ident_char(l[end])) end++;
+                    auto define = defines.find(l.substr(i, end - i));
+                    if (define != defines.end()) {
+                        flush(i);
+                        if (emitting) emit(define->second, file, line);
+                        span = end;
+                    }
+                    i = end;
+                } else if (c == '{' && !in_block) {
+                    in_block = true;
+                    if (is_import) {
+                        emitting = true;
+                        span = i + 1;
+                    } else {
+                        flush(i + 1);
+                    }
+                    if (!early_imports.empty()) {
+                        newline();
+                        for (const std::string& name : early_imports) {
+                            import(name);
+                            newline();
+                        }
+                        early_imports.clear();
+                    }
+                    i++;
+                } else if (is_import && in_block && (c == '{' || c == '}')) {
+                    if (c == '{') {
+                        depth++;
+                    } else if (depth-- == 0) {
+                        // End of the imported file's outer block; the rest of it is dropped
+                        flush(i);
+                        return;
+                    }
+                    i++;
+                } else {
+                    i++;
+                }
+            }
+            flush(i);
+        }
+
+        if (eol < text.size() && emitting) {
+            newline();
         }
     }
-    
-    return final_result;
 }
 
-std::string preprocess(const std::string& source) {
-    // Step 1: Process imports (each file preprocessed in isolation)
-    std::unordered_set<std::string> imported;
-    std::string with_imports = process_imports(source, imported);
-    
-    // Step 2: Preprocess the main file (comments + defines)
-    std::string result = preprocess_single(with_imports);
-    
-    return result;
+std::string preprocess(std::string_view source, const std::string& filename, LineMap& line_map) {
+    line_map.clear();
+    line_map.files.push_back(filename);
+    line_map.entries.push_back({1, 0, 1});
+
+    Preprocessor preprocessor(line_map);
+    preprocessor.out.reserve(source.size());
+    preprocessor.run(source, 0, false);
+    return std::move(preprocessor.out);
 }
@@ -2,7 +2,38 @@
 #define PREPROCESSOR_HPP
 
 #include <string>
+#include <string_view>
+#include <vector>
 
-std::string preprocess(const std::string& source);
+// Where each line of preprocessed output came from, so errors can name the
+// original file:line after imports have been spliced in
+class LineMap {
+public:
+    struct Entry {
+        int output_line;  // First output line of a run of consecutive source lines
+        int file;         // Index into files
+        int line;
+    };
+
+    std::vector<std::string> files;
+    std::vector<Entry> entries;
+
+    // "file:line" for a (1-based) line of the preprocessed output
+    std::string locate(int output_line) const;
+    void clear();
+};
+
+// Directory for the import cache; empty (the default) disables it.
+// Each import's preprocessed text and line map entries are stored under the hash of its content,
+// together with the hashes of everything it imports, and reused while none of those change.
+extern std::string import_cache_dir;
+
+// $XDG_CACHE_HOME/miaow, or ~/.cache/miaow
+std::string default_import_cache_dir();
+
+// Strip comments and expand !define and !import in one pass over the source.
+// Imported files are read through a memory mapping and spliced into the output;
+// line_map is filled in with where each output line came from.
+std::string preprocess(std::string_view source, const std::string& filename, LineMap& line_map);
 
 #endif
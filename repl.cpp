@@ -0,0 +1,228 @@
+#include "repl.hpp"
+#include "types.hpp"
+#include "intrinsics.hpp"
+#include "parser.hpp"
+#include "compiler.hpp"
+#include "checker.hpp"
+#include "preprocessor.hpp"
+#include "session.hpp"
+#include "jit.hpp"
+#include "runtime.hpp"
+
+#include <cstdio>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+// Prefix for the globals backing REPL variables, so they can't clash with libc symbols
+static const std::string REPL_VAR_PREFIX = "repl.";
+
+// Every top-level def becomes a global, so later inputs can still see it
+// (defs inside blocks and funs are scoped to them)
+static void collect_repl_variables(Molecule& root, std::unordered_map<std::string, TypeRef>& vars) {
+    for (size_t i = 1; i < root.atoms.size(); i++) {
+        if (!std::holds_alternative<Molecule>(root.atoms[i])) continue;
+        Molecule& mol = std::get<Molecule>(root.atoms[i]);
+        if (mol.atoms.size() < 2 || !std::holds_alternative<Atom>(mol.subject())) continue;
+
+        if (std::get<Atom>(mol.subject()).identifier == "def" && std::holds_alternative<Atom>(mol.atoms[1])) {
+            Atom& var_atom = std::get<Atom>(mol.atoms[1]);
+            if (var_atom.type && !vars.count(var_atom.identifier)) {
+                vars[var_atom.identifier] = var_atom.type;
+            }
+        }
+    }
+}
+
+// Change in bracket nesting over one line of input (strings and ; comments ignored)
+static int bracket_depth(const std::string& line, bool& in_string) {
+    int depth = 0;
+    for (char c : line) {
+        if (c == '"') {
+            in_string = !in_string;
+        } else if (in_string) {
+            continue;
+        } else if (c == ';') {
+            break;
+        } else if (c == '(' || c == '[' || c == '{') {
+            depth++;
+        } else if (c == ')' || c == ']' || c == '}') {
+            depth--;
+        }
+    }
+    return depth;
+}
+
+// The JIT takes ownership of a module's context, but the compiler keeps using the session's context
+// (its struct_registry and intrinsics hold types from it), so each input moves over via bitcode
+static std::unique_ptr<llvm::Module> move_to_context(llvm::Module& module, llvm::LLVMContext& context) {
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream out(buffer);
+    llvm::WriteBitcodeToFile(module, out);
+
+    llvm::MemoryBufferRef ref(llvm::StringRef(buffer.data(), buffer.size()), module.getName());
+    llvm::Expected<std::unique_ptr<llvm::Module>> copy = llvm::parseBitcodeFile(ref, context);
+    if (!copy) {
+        std::cerr << "Error: " << llvm::toString(copy.takeError()) << std::endl;
+        return nullptr;
+    }
+    return std::move(*copy);
+}
+
+// The funs, externs and overloads from before an input. The type pass registers the input's own as it
+// reaches them, so they are taken out again if the input doesn't make it into the JIT.
+class SavedDeclarations {
+public:
+    SavedDeclarations() : intrinsics(session->intrinsics), overloads(session->overload_registry) {}
+
+    void restore() {
+        for (auto it = session->intrinsics.begin(); it != session->intrinsics.end();) {
+            auto saved = intrinsics.find(it->first);
+            if (saved == intrinsics.end()) {
+                it = session->intrinsics.erase(it);
+            } else {
+                it->second = saved->second;  // In place, so the Function pointers in overloads stay valid
+                ++it;
+            }
+        }
+        session->overload_registry = overloads;
+    }
+
+private:
+    std::unordered_map<std::string, Function> intrinsics;
+    std::unordered_map<std::string, std::map<std::vector<TypeRef>, Function*>> overloads;
+};
+
+// Compile one input into its own module and run it
+static void run_input(llvm::orc::LLLazyJIT& jit, const std::string& input,
+                      std::unordered_map<std::string, TypeRef>& globals, int input_number) {
+    // Nothing keeps the previous input's AST around
+    session->ast_arena.clear();
+
+    std::string source = preprocess("{" + input + "\n}", "<repl>", session->line_map);
+    std::string_view source_view(source);
+    int parse_errors = 0;
+    Particle root_particle = Particle(lexparse(source_view, parse_errors));
+    if (parse_errors > 0) {
+        return;
+    }
+    Molecule& root_mol = std::get<Molecule>(root_particle);
+
+    std::string entry_name = "__repl_" + std::to_string(input_number);
+    session->module = std::make_unique<llvm::Module>(entry_name, *session->context);
+    session->module->setDataLayout(jit.getDataLayout());
+    session->module->setTargetTriple(jit.getTargetTriple());
+    session->string_literals.clear();
+
+    collect_struct_declarations(root_particle);
+
+    // Variables from earlier inputs are defined in earlier modules; refer to them by name
+    session->object_registry.clear();
+    for (auto& [var_name, var_type] : globals) {
+        llvm::GlobalVariable* var = new llvm::GlobalVariable(*session->module, get_storage_type(var_type), false,
+            llvm::GlobalValue::ExternalLinkage, nullptr, REPL_VAR_PREFIX + var_name);
+        session->object_registry.define(var_name, MemObject(var_type, var));
+    }
+
+    std::unordered_map<std::string, TypeRef> new_vars;
+    collect_repl_variables(root_mol, new_vars);
+    for (auto& [var_name, var_type] : new_vars) {
+        if (globals.count(var_name)) continue;
+        llvm::Type* llvm_type = get_storage_type(var_type);
+        llvm::GlobalVariable* var = new llvm::GlobalVariable(*session->module, llvm_type, false,
+            llvm::GlobalValue::ExternalLinkage, llvm::Constant::getNullValue(llvm_type), REPL_VAR_PREFIX + var_name);
+        session->object_registry.define(var_name, MemObject(var_type, var));
+    }
+
+    SavedDeclarations declarations;
+    if (typecheck(root_mol, globals) > 0) {
+        declarations.restore();
+        return;
+    }
+
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), false);
+    llvm::Function* entry = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, entry_name, session->module.get());
+    session->builder->SetInsertPoint(llvm::BasicBlock::Create(*session->context, "entry", entry));
+
+    // Literals assigned to REPL variables must outlive this call
+    session->static_scope = entry;
+    for (size_t i = 1; i < root_mol.atoms.size(); i++) {
+        compile(root_mol.atoms[i]);
+    }
+    session->static_scope = nullptr;
+    clear_temporaries();
+
+    if (!session->builder->GetInsertBlock()->getTerminator()) {
+        session->builder->CreateRetVoid();
+    }
+    // Each input's output shows up before the next prompt
+    flush_output_before_returns(entry);
+
+    if (llvm::verifyModule(*session->module, &llvm::errs())) {
+        std::cerr << "Error: input could not be compiled" << std::endl;
+        declarations.restore();
+        return;
+    }
+
+    auto context = std::make_unique<llvm::LLVMContext>();
+    std::unique_ptr<llvm::Module> module = move_to_context(*session->module, *context);
+    if (!module || !add_module_to_jit(jit, std::move(module), std::move(context))) {
+        declarations.restore();
+        return;
+    }
+
+    // Only now are this input's variables defined in the JIT
+    for (auto& [var_name, var_type] : new_vars) {
+        globals[var_name] = var_type;
+    }
+
+    auto entry_addr = jit.lookup(entry_name);
+    if (!entry_addr) {
+        std::cerr << "Error: " << llvm::toString(entry_addr.takeError()) << std::endl;
+        return;
+    }
+    auto run = entry_addr->toPtr<void (*)()>();
+    run();
+    fflush(stdout);
+}
+
+int run_repl(int opt_level) {
+    // One session for the whole REPL: structs, funs and overloads carry over between inputs
+    CompilerSession compiler("miaow_repl");
+    std::unique_ptr<llvm::orc::LLLazyJIT> jit = create_jit(opt_level);
+    if (!jit) {
+        return 1;
+    }
+
+    std::unordered_map<std::string, TypeRef> globals;  // REPL variable name -> type
+    int input_count = 0;
+
+    // Read lines until the brackets of a form are balanced, then run it
+    std::string pending;
+    int depth = 0;
+    bool in_string = false;
+    std::string line;
+
+    std::cout << "miaow> " << std::flush;
+    while (std::getline(std::cin, line)) {
+        pending += line + "\n";
+        depth += bracket_depth(line, in_string);
+        if (depth > 0 || in_string) {
+            std::cout << "  ...> " << std::flush;
+            continue;
+        }
+
+        if (pending.find_first_not_of(WHITESPACE) != std::string::npos) {
+            run_input(*jit, pending, globals, ++input_count);
+        }
+        pending.clear();
+        depth = 0;
+        in_string = false;
+        std::cout << "miaow> " << std::flush;
+    }
+    std::cout << std::endl;
+    return 0;
+}
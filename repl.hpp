@@ -0,0 +1,9 @@
+#ifndef REPL_HPP
+#define REPL_HPP
+
+// Interactive session: each input form is compiled into its own module,
+// added to a persistent JIT and run immediately. funs, structs and variables
+// defined by earlier inputs stay usable. Returns when stdin is closed.
+int run_repl(int opt_level);
+
+#endif // REPL_HPP
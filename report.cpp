@@ -0,0 +1,113 @@
+#include "report.hpp"
+
+#include <cstdio>
+#include <sys/resource.h>
+
+#include <llvm/IR/Instructions.h>
+
+// Peak resident set size of the process so far, in KB
+static long peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+static size_t count_nodes(const Particle& p) {
+    size_t count = 1;
+    if (std::holds_alternative<Molecule>(p)) {
+        for (const Particle& child : std::get<Molecule>(p).atoms) {
+            count += count_nodes(child);
+        }
+    }
+    return count;
+}
+
+// text as the body of a JSON string
+static std::string json_escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void TimeReport::begin(const std::string& phase) {
+    if (!enabled) return;
+    PhaseStats stats;
+    stats.name = phase;
+    phases.push_back(stats);
+    phase_start_rss_kb = peak_rss_kb();
+    phase_start = std::chrono::steady_clock::now();
+}
+
+void TimeReport::end(const Particle* ast, const llvm::Module* module) {
+    if (!enabled || phases.empty()) return;
+    PhaseStats& stats = phases.back();
+    stats.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - phase_start).count();
+    stats.peak_rss_delta_kb = peak_rss_kb() - phase_start_rss_kb;
+
+    // Counting is not part of the phase's time
+    if (ast) {
+        stats.ast_nodes = count_nodes(*ast);
+    }
+    if (module) {
+        for (const llvm::Function& func : *module) {
+            for (const llvm::BasicBlock& block : func) {
+                for (const llvm::Instruction& inst : block) {
+                    stats.instructions++;
+                    if (llvm::isa<llvm::AllocaInst>(inst)) stats.allocas++;
+                }
+            }
+        }
+    }
+}
+
+void TimeReport::print() const {
+    if (!enabled) return;
+
+    double total_ms = 0;
+    for (const PhaseStats& stats : phases) {
+        total_ms += stats.wall_ms;
+    }
+
+    if (json) {
+        fprintf(stderr, "{");
+        if (!file.empty()) fprintf(stderr, "\"file\": \"%s\", ", json_escape(file).c_str());
+        fprintf(stderr, "\"phases\": [");
+        for (size_t i = 0; i < phases.size(); i++) {
+            const PhaseStats& stats = phases[i];
+            fprintf(stderr, "%s\n  {\"name\": \"%s\", \"wall_ms\": %.3f, \"peak_rss_delta_kb\": %ld, "
+                    "\"ast_nodes\": %zu, \"allocas\": %zu, \"instructions\": %zu}",
+                    i ? "," : "", stats.name.c_str(), stats.wall_ms, stats.peak_rss_delta_kb,
+                    stats.ast_nodes, stats.allocas, stats.instructions);
+        }
+        fprintf(stderr, "\n], \"total_wall_ms\": %.3f, \"peak_rss_kb\": %ld, \"rss_process_wide\": %s}\n",
+                total_ms, peak_rss_kb(), shared_process ? "true" : "false");
+        return;
+    }
+
+    if (file.empty()) {
+        fprintf(stderr, "===- miaow time report -===\n");
+    } else {
+        fprintf(stderr, "===- miaow time report: %s -===\n", file.c_str());
+    }
+    fprintf(stderr, "%-12s %12s %14s %10s %9s %10s\n", "phase", "wall (ms)", shared_process ? "proc rss +KB*" : "peak rss +KB",
+            "ast nodes", "allocas", "ir insts");
+    for (const PhaseStats& stats : phases) {
+        fprintf(stderr, "%-12s %12.3f %14ld %10zu %9zu %10zu\n", stats.name.c_str(), stats.wall_ms,
+                stats.peak_rss_delta_kb, stats.ast_nodes, stats.allocas, stats.instructions);
+    }
+    fprintf(stderr, "%-12s %12.3f %14s peak rss %ld KB\n", "total", total_ms, "", peak_rss_kb());
+    if (shared_process) {
+        fprintf(stderr, "* rss is of the whole process, which compiles other files at the same time (-j)\n");
+    }
+}
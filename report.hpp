@@ -0,0 +1,45 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#include "types.hpp"
+
+#include <chrono>
+
+// Measurements for one compiler phase
+struct PhaseStats {
+    std::string name;
+    double wall_ms = 0;
+    long peak_rss_delta_kb = 0;  // growth of the process's peak RSS during the phase
+    size_t ast_nodes = 0;        // AST size after the phase
+    size_t allocas = 0;          // counts in the module after the phase
+    size_t instructions = 0;
+};
+
+// --time-report: times each phase of the driver and prints a table (or JSON) to stderr.
+// When disabled, begin/end do nothing, so the driver can call them unconditionally.
+class TimeReport {
+public:
+    explicit TimeReport(bool enabled = false, bool json = false) : enabled(enabled), json(json) {}
+
+    bool is_enabled() const { return enabled; }
+    // Name the file being compiled in the output (set when several files are compiled at once)
+    void set_file(const std::string& name) { file = name; }
+    // Other compiles run in the same process (-j N), so the RSS figures include their memory too
+    void set_shared_process(bool shared) { shared_process = shared; }
+
+    void begin(const std::string& phase);
+    // Close the current phase; ast/module (either may be null) are counted for the row
+    void end(const Particle* ast, const llvm::Module* module);
+    void print() const;
+
+private:
+    bool enabled;
+    bool json;
+    std::string file;
+    bool shared_process = false;
+    std::vector<PhaseStats> phases;
+    std::chrono::steady_clock::time_point phase_start;
+    long phase_start_rss_kb = 0;
+};
+
+#endif // REPORT_HPP
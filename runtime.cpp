@@ -0,0 +1,671 @@
+#include "runtime.hpp"
+#include "session.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+
+static llvm::Type* ptr_type() {
+    return llvm::PointerType::getUnqual(*session->context);
+}
+
+// size_t of the target (i32 for wasm)
+static llvm::IntegerType* size_type() {
+    return session->module->getDataLayout().getIntPtrType(*session->context);
+}
+
+// A length as size_t, for memcpy and memset: backends pass their length to libc as it is, without widening it
+static llvm::Value* byte_count(llvm::IRBuilder<>& builder, llvm::Value* length) {
+    return builder.CreateZExt(length, size_type());
+}
+
+// A runtime global, created in the module on first use
+static llvm::GlobalVariable* runtime_global(const std::string& name, llvm::Type* type) {
+    if (llvm::GlobalVariable* existing = session->module->getGlobalVariable(name)) return existing;
+    return new llvm::GlobalVariable(*session->module, type, false, llvm::GlobalValue::LinkOnceODRLinkage,
+                                    llvm::Constant::getNullValue(type), name);
+}
+
+// Bytes of the output buffer in use
+static llvm::GlobalVariable* output_used() {
+    return runtime_global("miaow.out_used", llvm::Type::getInt32Ty(*session->context));
+}
+
+static llvm::GlobalVariable* output_buffer() {
+    return runtime_global("miaow.out_buf", llvm::ArrayType::get(llvm::Type::getInt8Ty(*session->context), OUTPUT_BUFFER_SIZE));
+}
+
+// A runtime function, created in the module on first use; build_body fills in its body with its own builder,
+// so the insertion point of the code being compiled is left alone
+static llvm::Function* runtime_function(const std::string& name, llvm::FunctionType* FT,
+                                        const std::function<void(llvm::Function*, llvm::IRBuilder<>&)>& build_body) {
+    if (llvm::Function* existing = session->module->getFunction(name)) return existing;
+    llvm::Function* func = llvm::Function::Create(FT, llvm::Function::LinkOnceODRLinkage, name, session->module.get());
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(*session->context, "entry", func));
+    build_body(func, builder);
+    return func;
+}
+
+// miaow.write_all(data, size): write(2) to stdout until all of it is written or writing fails
+static llvm::Function* write_all_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), {ptr_type(), size_type()}, false);
+    return runtime_function("miaow.write_all", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::FunctionType* write_type = llvm::FunctionType::get(size_type(),
+            {llvm::Type::getInt32Ty(*session->context), ptr_type(), size_type()}, false);
+        llvm::FunctionCallee write = session->module->getOrInsertFunction("write", write_type);
+
+        llvm::Value* data = func->getArg(0);
+        llvm::Value* size = func->getArg(1);
+        llvm::BasicBlock* entry = builder.GetInsertBlock();
+        llvm::BasicBlock* check = llvm::BasicBlock::Create(*session->context, "check", func);
+        llvm::BasicBlock* body = llvm::BasicBlock::Create(*session->context, "write", func);
+        llvm::BasicBlock* wrote = llvm::BasicBlock::Create(*session->context, "wrote", func);
+        llvm::BasicBlock* done = llvm::BasicBlock::Create(*session->context, "done", func);
+        builder.CreateBr(check);
+
+        builder.SetInsertPoint(check);
+        llvm::PHINode* offset = builder.CreatePHI(size_type(), 2, "offset");
+        offset->addIncoming(llvm::ConstantInt::get(size_type(), 0), entry);
+        builder.CreateCondBr(builder.CreateICmpSLT(offset, size), body, done);
+
+        // A short write (pipe, signal) continues where it stopped
+        builder.SetInsertPoint(body);
+        llvm::Value* from = builder.CreateInBoundsGEP(builder.getInt8Ty(), data, offset);
+        llvm::Value* written = builder.CreateCall(write, {builder.getInt32(1), from, builder.CreateSub(size, offset)});
+        builder.CreateCondBr(builder.CreateICmpSGT(written, llvm::ConstantInt::get(size_type(), 0)), wrote, done);
+
+        builder.SetInsertPoint(wrote);
+        offset->addIncoming(builder.CreateAdd(offset, written), wrote);
+        builder.CreateBr(check);
+
+        builder.SetInsertPoint(done);
+        builder.CreateRetVoid();
+    });
+}
+
+// miaow.flush(): write out the output buffer and empty it
+static llvm::Function* flush_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), false);
+    return runtime_function("miaow.flush", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::GlobalVariable* used_var = output_used();
+        llvm::BasicBlock* write = llvm::BasicBlock::Create(*session->context, "write", func);
+        llvm::BasicBlock* done = llvm::BasicBlock::Create(*session->context, "done", func);
+
+        llvm::Value* used = builder.CreateLoad(builder.getInt32Ty(), used_var, "used");
+        builder.CreateCondBr(builder.CreateICmpEQ(used, builder.getInt32(0)), done, write);
+
+        builder.SetInsertPoint(write);
+        builder.CreateCall(write_all_function(), {output_buffer(), builder.CreateZExt(used, size_type())});
+        builder.CreateStore(builder.getInt32(0), used_var);
+        builder.CreateBr(done);
+
+        builder.SetInsertPoint(done);
+        builder.CreateRetVoid();
+    });
+}
+
+// miaow.write_line(data, len): append a line to the output buffer. Lines that don't fit
+// flush it first; lines longer than the whole buffer are written directly.
+static llvm::Function* write_line_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context),
+        {ptr_type(), llvm::Type::getInt32Ty(*session->context)}, false);
+    return runtime_function("miaow.write_line", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::GlobalVariable* used_var = output_used();
+        llvm::GlobalVariable* buffer = output_buffer();
+        llvm::Value* data = func->getArg(0);
+        llvm::Value* len = func->getArg(1);
+        llvm::Value* capacity = builder.getInt32(OUTPUT_BUFFER_SIZE);
+
+        llvm::BasicBlock* full = llvm::BasicBlock::Create(*session->context, "full", func);
+        llvm::BasicBlock* direct = llvm::BasicBlock::Create(*session->context, "direct", func);
+        llvm::BasicBlock* copy = llvm::BasicBlock::Create(*session->context, "copy", func);
+
+        llvm::Value* needed = builder.CreateAdd(len, builder.getInt32(1), "needed");  // With the newline
+        llvm::Value* used = builder.CreateLoad(builder.getInt32Ty(), used_var, "used");
+        builder.CreateCondBr(builder.CreateICmpULE(builder.CreateAdd(used, needed), capacity), copy, full);
+
+        builder.SetInsertPoint(full);
+        builder.CreateCall(flush_function());
+        builder.CreateCondBr(builder.CreateICmpUGT(needed, capacity), direct, copy);
+
+        builder.SetInsertPoint(direct);
+        builder.CreateCall(write_all_function(), {data, builder.CreateZExt(len, size_type())});
+        builder.CreateCall(write_all_function(), {builder.CreateGlobalString("\n"), llvm::ConstantInt::get(size_type(), 1)});
+        builder.CreateRetVoid();
+
+        builder.SetInsertPoint(copy);
+        llvm::Value* start = builder.CreateLoad(builder.getInt32Ty(), used_var, "start");
+        llvm::Value* dst = builder.CreateInBoundsGEP(builder.getInt8Ty(), buffer, start);
+        builder.CreateMemCpy(dst, llvm::MaybeAlign(1), data, llvm::MaybeAlign(1), byte_count(builder, len));
+        builder.CreateStore(builder.getInt8('\n'), builder.CreateInBoundsGEP(builder.getInt8Ty(), dst, len));
+        builder.CreateStore(builder.CreateAdd(start, needed), used_var);
+        builder.CreateRetVoid();
+    });
+}
+
+// A runtime constant, created in the module on first use
+static llvm::GlobalVariable* runtime_constant(const std::string& name, llvm::Constant* value) {
+    if (llvm::GlobalVariable* existing = session->module->getGlobalVariable(name)) return existing;
+    return new llvm::GlobalVariable(*session->module, value->getType(), true, llvm::GlobalValue::LinkOnceODRLinkage,
+                                    value, name);
+}
+
+// "00" "01" ... "99": two digits per table lookup instead of one division per digit
+static llvm::GlobalVariable* digit_pairs() {
+    std::string pairs;
+    for (int i = 0; i < 100; i++) {
+        pairs += char('0' + i / 10);
+        pairs += char('0' + i % 10);
+    }
+    return runtime_constant("miaow.digit_pairs", llvm::ConstantDataArray::getString(*session->context, pairs, false));
+}
+
+// 10^k as the nearest double, for k from -POW10_BIAS to POW10_BIAS
+constexpr int POW10_BIAS = 64;
+
+static llvm::GlobalVariable* powers_of_ten() {
+    std::vector<double> powers;
+    for (int k = -POW10_BIAS; k <= POW10_BIAS; k++) {
+        powers.push_back(std::strtod(("1e" + std::to_string(k)).c_str(), nullptr));
+    }
+    return runtime_constant("miaow.pow10", llvm::ConstantDataArray::get(*session->context, powers));
+}
+
+// miaow.format_int(value, buf) -> length
+static llvm::Function* format_int_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context),
+        {llvm::Type::getInt32Ty(*session->context), ptr_type()}, false);
+    return runtime_function("miaow.format_int", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::Value* value = func->getArg(0);
+        llvm::Value* buf = func->getArg(1);
+        llvm::GlobalVariable* pairs = digit_pairs();
+        llvm::BasicBlock* entry = builder.GetInsertBlock();
+        llvm::BasicBlock* check = llvm::BasicBlock::Create(*session->context, "check", func);
+        llvm::BasicBlock* pair = llvm::BasicBlock::Create(*session->context, "pair", func);
+        llvm::BasicBlock* last = llvm::BasicBlock::Create(*session->context, "last", func);
+        llvm::BasicBlock* last_pair = llvm::BasicBlock::Create(*session->context, "last_pair", func);
+        llvm::BasicBlock* last_digit = llvm::BasicBlock::Create(*session->context, "last_digit", func);
+
+        // The magnitude as unsigned, so INT_MIN negates to itself and still prints right
+        llvm::Value* negative = builder.CreateICmpSLT(value, builder.getInt32(0));
+        llvm::Value* magnitude = builder.CreateSelect(negative, builder.CreateNeg(value), value, "magnitude");
+
+        // Digit count without dividing: one more for every power of ten the magnitude reaches
+        llvm::Value* length = builder.CreateZExt(negative, builder.getInt32Ty());
+        unsigned power = 1;
+        for (int digit = 0; digit < 10; digit++) {
+            length = builder.CreateAdd(length, builder.CreateZExt(builder.CreateICmpUGE(magnitude, builder.getInt32(power)), builder.getInt32Ty()));
+            power *= 10;
+        }
+        length = builder.CreateAdd(length, builder.CreateZExt(builder.CreateICmpEQ(magnitude, builder.getInt32(0)), builder.getInt32Ty()), "length");
+
+        // Digits are written back to front; without a sign the first one overwrites the '-'
+        builder.CreateStore(builder.getInt8('-'), buf);
+        builder.CreateStore(builder.getInt8(0), builder.CreateInBoundsGEP(builder.getInt8Ty(), buf, length));
+        builder.CreateBr(check);
+
+        builder.SetInsertPoint(check);
+        llvm::PHINode* rest = builder.CreatePHI(builder.getInt32Ty(), 2, "rest");
+        llvm::PHINode* end = builder.CreatePHI(builder.getInt32Ty(), 2, "end");
+        rest->addIncoming(magnitude, entry);
+        end->addIncoming(length, entry);
+        builder.CreateCondBr(builder.CreateICmpUGE(rest, builder.getInt32(100)), pair, last);
+
+        builder.SetInsertPoint(pair);
+        llvm::Value* quotient = builder.CreateUDiv(rest, builder.getInt32(100));
+        llvm::Value* two_digits = builder.CreateSub(rest, builder.CreateMul(quotient, builder.getInt32(100)));
+        llvm::Value* pair_end = builder.CreateSub(end, builder.getInt32(2));
+        builder.CreateMemCpy(builder.CreateInBoundsGEP(builder.getInt8Ty(), buf, pair_end), llvm::MaybeAlign(1),
+                             builder.CreateInBoundsGEP(builder.getInt8Ty(), pairs, builder.CreateShl(two_digits, 1)), llvm::MaybeAlign(1), 2);
+        rest->addIncoming(quotient, pair);
+        end->addIncoming(pair_end, pair);
+        builder.CreateBr(check);
+
+        // One or two digits left
+        builder.SetInsertPoint(last);
+        builder.CreateCondBr(builder.CreateICmpUGE(rest, builder.getInt32(10)), last_pair, last_digit);
+
+        builder.SetInsertPoint(last_pair);
+        builder.CreateMemCpy(builder.CreateInBoundsGEP(builder.getInt8Ty(), buf, builder.CreateSub(end, builder.getInt32(2))), llvm::MaybeAlign(1),
+                             builder.CreateInBoundsGEP(builder.getInt8Ty(), pairs, builder.CreateShl(rest, 1)), llvm::MaybeAlign(1), 2);
+        builder.CreateRet(length);
+
+        builder.SetInsertPoint(last_digit);
+        builder.CreateStore(builder.CreateTrunc(builder.CreateAdd(rest, builder.getInt32('0')), builder.getInt8Ty()),
+                            builder.CreateInBoundsGEP(builder.getInt8Ty(), buf, builder.CreateSub(end, builder.getInt32(1))));
+        builder.CreateRet(length);
+    });
+}
+
+// miaow.format_float(value, buf) -> length. Tries 1 to 9 significant digits and keeps the first that
+// lies inside the interval of numbers that round to the same Float (9 digits always do). The interval is
+// exact in double precision. A candidate on one of its ends reads back as the Float only if the Float's
+// mantissa is even, and that is only decided where the candidate is computed exactly; elsewhere candidates
+// within rounding error of the ends are skipped, and take a digit more than strictly needed.
+static llvm::Function* format_float_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context),
+        {llvm::Type::getFloatTy(*session->context), ptr_type()}, false);
+    return runtime_function("miaow.format_float", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::Value* value = func->getArg(0);
+        llvm::Value* buf = func->getArg(1);
+        llvm::GlobalVariable* powers = powers_of_ten();
+        llvm::Type* i8 = builder.getInt8Ty();
+        llvm::Type* i32 = builder.getInt32Ty();
+        llvm::Type* f64 = builder.getDoubleTy();
+        auto byte_at = [&](llvm::Value* base, llvm::Value* index) { return builder.CreateGEP(i8, base, index); };
+        auto pow10 = [&](llvm::Value* exponent) {
+            llvm::Value* index = builder.CreateAdd(exponent, builder.getInt32(POW10_BIAS));
+            return builder.CreateLoad(f64, builder.CreateInBoundsGEP(f64, powers, index));
+        };
+        auto block = [&](const char* name) { return llvm::BasicBlock::Create(*session->context, name, func); };
+        llvm::BasicBlock* special = block("special");
+        llvm::BasicBlock* nan = block("nan");
+        llvm::BasicBlock* not_nan = block("not_nan");
+        llvm::BasicBlock* inf = block("inf");
+        llvm::BasicBlock* zero = block("zero");
+        llvm::BasicBlock* finite = block("finite");
+        llvm::BasicBlock* search = block("search");
+        llvm::BasicBlock* next = block("next");
+        llvm::BasicBlock* found = block("found");
+        llvm::BasicBlock* digits = block("digits");
+        llvm::BasicBlock* layout = block("layout");
+        llvm::BasicBlock* fixed = block("fixed");
+        llvm::BasicBlock* integral = block("integral");
+        llvm::BasicBlock* fraction = block("fraction");
+        llvm::BasicBlock* scientific = block("scientific");
+        llvm::BasicBlock* done = block("done");
+
+        // Up to 9 significant digits, most significant first
+        llvm::ArrayType* digits_type = llvm::ArrayType::get(i8, 10);
+        llvm::Value* digit_buf = builder.CreateAlloca(digits_type, nullptr, "digit_buf");
+
+        llvm::Value* negative = builder.CreateICmpSLT(builder.CreateBitCast(value, i32), builder.getInt32(0));
+        llvm::Value* start = builder.CreateZExt(negative, i32, "start");
+        builder.CreateStore(builder.getInt8('-'), buf);  // Overwritten when there is no sign
+        llvm::Value* abs_value = builder.CreateUnaryIntrinsic(llvm::Intrinsic::fabs, value);
+        llvm::Value* magnitude = builder.CreateFPExt(abs_value, f64, "magnitude");
+        llvm::Value* is_finite = builder.CreateFCmpOLT(magnitude, llvm::ConstantFP::getInfinity(f64));
+        llvm::Value* is_zero = builder.CreateFCmpOEQ(magnitude, llvm::ConstantFP::get(f64, 0.0));
+        builder.CreateCondBr(builder.CreateAnd(is_finite, builder.CreateNot(is_zero)), finite, special);
+
+        auto write_text = [&](llvm::Value* at, const std::string& text) {
+            builder.CreateMemCpy(byte_at(buf, at), llvm::MaybeAlign(1), builder.CreateGlobalString(text), llvm::MaybeAlign(1), text.size() + 1);
+            builder.CreateRet(builder.CreateAdd(at, builder.getInt32(text.size())));
+        };
+        builder.SetInsertPoint(special);
+        builder.CreateCondBr(builder.CreateFCmpUNO(magnitude, magnitude), nan, not_nan);
+        builder.SetInsertPoint(nan);
+        write_text(builder.getInt32(0), "nan");
+        builder.SetInsertPoint(not_nan);
+        builder.CreateCondBr(is_zero, zero, inf);
+        builder.SetInsertPoint(inf);
+        write_text(start, "inf");
+        builder.SetInsertPoint(zero);
+        write_text(start, "0.0");
+
+        // Decimal exponent: floor(binary exponent * log10(2)), then corrected by one either way if it is off
+        builder.SetInsertPoint(finite);
+        llvm::Value* biased = builder.CreateLShr(builder.CreateBitCast(magnitude, builder.getInt64Ty()), 52);
+        llvm::Value* binary_exponent = builder.CreateSub(builder.CreateTrunc(biased, i32), builder.getInt32(1023));
+        llvm::Value* estimate = builder.CreateAShr(builder.CreateMul(binary_exponent, builder.getInt32(78913)), 18);
+        estimate = builder.CreateSelect(builder.CreateFCmpOLT(magnitude, pow10(estimate)),
+                                        builder.CreateSub(estimate, builder.getInt32(1)), estimate);
+        llvm::Value* exponent = builder.CreateSelect(builder.CreateFCmpOGE(magnitude, pow10(builder.CreateAdd(estimate, builder.getInt32(1)))),
+                                                     builder.CreateAdd(estimate, builder.getInt32(1)), estimate, "exponent");
+
+        // Halfway to the neighbouring Floats; the gap below a power of two is half the gap above
+        llvm::Value* float_bits = builder.CreateBitCast(abs_value, i32);
+        llvm::Value* float_exponent = builder.CreateLShr(float_bits, 23);
+        llvm::Value* float_fraction = builder.CreateAnd(float_bits, builder.getInt32(0x7fffff));
+        llvm::Value* ulp_exponent = builder.CreateSub(builder.CreateSelect(builder.CreateICmpUGT(float_exponent, builder.getInt32(1)),
+                                                                           float_exponent, builder.getInt32(1)), builder.getInt32(150));
+        llvm::Value* ulp = builder.CreateBitCast(builder.CreateShl(builder.CreateSExt(builder.CreateAdd(ulp_exponent, builder.getInt32(1023)),
+                                                                                      builder.getInt64Ty()), 52), f64, "ulp");
+        llvm::Value* half_up = builder.CreateFMul(ulp, llvm::ConstantFP::get(f64, 0.5));
+        llvm::Value* at_power_of_two = builder.CreateAnd(builder.CreateICmpEQ(float_fraction, builder.getInt32(0)),
+                                                         builder.CreateICmpUGT(float_exponent, builder.getInt32(1)));
+        llvm::Value* half_down = builder.CreateSelect(at_power_of_two, builder.CreateFMul(ulp, llvm::ConstantFP::get(f64, 0.25)), half_up);
+        llvm::Value* upper = builder.CreateFAdd(magnitude, half_up, "upper");
+        llvm::Value* lower = builder.CreateFSub(magnitude, half_down, "lower");
+        builder.CreateBr(search);
+
+        builder.SetInsertPoint(search);
+        llvm::PHINode* precision = builder.CreatePHI(i32, 2, "precision");
+        precision->addIncoming(builder.getInt32(1), finite);
+        llvm::Value* shift = builder.CreateSub(builder.CreateSub(precision, builder.getInt32(1)), exponent, "shift");
+        llvm::Value* scaled = builder.CreateFAdd(builder.CreateFMul(magnitude, pow10(shift)), llvm::ConstantFP::get(f64, 0.5));
+        llvm::Value* mantissa = builder.CreateFPToSI(scaled, builder.getInt64Ty(), "mantissa");
+        // mantissa * 10^-shift, with an exact power of ten for |shift| <= 22 so a single rounding is done
+        llvm::Value* mantissa_fp = builder.CreateSIToFP(mantissa, f64);
+        llvm::Value* candidate = builder.CreateSelect(builder.CreateICmpSGE(shift, builder.getInt32(0)),
+                                                      builder.CreateFDiv(mantissa_fp, pow10(shift)),
+                                                      builder.CreateFMul(mantissa_fp, pow10(builder.CreateNeg(shift))), "candidate");
+        llvm::Value* margin = llvm::ConstantFP::get(f64, std::ldexp(1.0, -50));
+        llvm::Value* below_upper = builder.CreateFCmpOLT(builder.CreateFAdd(candidate, builder.CreateFMul(candidate, margin)), upper);
+        llvm::Value* above_lower = builder.CreateFCmpOGT(builder.CreateFSub(candidate, builder.CreateFMul(candidate, margin)), lower);
+        llvm::Value* inside = builder.CreateAnd(below_upper, above_lower);
+        // Halfway between two Floats reads back as the one with the even mantissa
+        llvm::Value* on_end = builder.CreateOr(builder.CreateFCmpOEQ(candidate, upper), builder.CreateFCmpOEQ(candidate, lower));
+        llvm::Value* computed_exactly = builder.CreateAnd(builder.CreateICmpSLE(shift, builder.getInt32(8)),
+                                                          builder.CreateFCmpOLT(candidate, llvm::ConstantFP::get(f64, std::ldexp(1.0, 53))));
+        llvm::Value* even = builder.CreateICmpEQ(builder.CreateAnd(float_bits, builder.getInt32(1)), builder.getInt32(0));
+        llvm::Value* rounds_back = builder.CreateOr(inside, builder.CreateAnd(on_end, builder.CreateAnd(computed_exactly, even)));
+        builder.CreateCondBr(builder.CreateOr(rounds_back, builder.CreateICmpEQ(precision, builder.getInt32(9))), found, next);
+
+        builder.SetInsertPoint(next);
+        precision->addIncoming(builder.CreateAdd(precision, builder.getInt32(1)), next);
+        builder.CreateBr(search);
+
+        // Rounding up can carry into a new digit (9.9999997e-6 -> 10e-6): that is 1 at the next exponent
+        builder.SetInsertPoint(found);
+        llvm::Value* carried = builder.CreateICmpEQ(mantissa, builder.CreateFPToSI(pow10(precision), builder.getInt64Ty()));
+        llvm::Value* final_mantissa = builder.CreateSelect(carried, builder.CreateUDiv(mantissa, builder.getInt64(10)), mantissa);
+        llvm::Value* final_exponent = builder.CreateAdd(exponent, builder.CreateZExt(carried, i32), "final_exponent");
+        llvm::Value* last_index = builder.CreateSub(precision, builder.getInt32(1));
+        builder.CreateBr(digits);
+
+        builder.SetInsertPoint(digits);
+        llvm::PHINode* index = builder.CreatePHI(i32, 2, "index");
+        llvm::PHINode* rest = builder.CreatePHI(builder.getInt64Ty(), 2, "rest");
+        index->addIncoming(last_index, found);
+        rest->addIncoming(final_mantissa, found);
+        llvm::Value* quotient = builder.CreateUDiv(rest, builder.getInt64(10));
+        llvm::Value* digit = builder.CreateSub(rest, builder.CreateMul(quotient, builder.getInt64(10)));
+        builder.CreateStore(builder.CreateTrunc(builder.CreateAdd(digit, builder.getInt64('0')), i8), byte_at(digit_buf, index));
+        index->addIncoming(builder.CreateSub(index, builder.getInt32(1)), digits);
+        rest->addIncoming(quotient, digits);
+        builder.CreateCondBr(builder.CreateICmpSGT(index, builder.getInt32(0)), digits, layout);
+
+        // Fixed notation for exponents from -4 to 15, like Python's repr
+        builder.SetInsertPoint(layout);
+        llvm::Value* in_fixed_range = builder.CreateAnd(builder.CreateICmpSGE(final_exponent, builder.getInt32(-4)),
+                                                        builder.CreateICmpSLT(final_exponent, builder.getInt32(16)));
+        builder.CreateCondBr(in_fixed_range, fixed, scientific);
+
+        builder.SetInsertPoint(fixed);
+        builder.CreateCondBr(builder.CreateICmpSGE(final_exponent, builder.getInt32(0)), integral, fraction);
+
+        // 1234.5, 100.0: the digits before the point padded with zeros, then the rest or a single 0
+        builder.SetInsertPoint(integral);
+        llvm::Value* int_digits = builder.CreateAdd(final_exponent, builder.getInt32(1));
+        builder.CreateMemSet(byte_at(buf, start), builder.getInt8('0'), byte_count(builder, int_digits), llvm::MaybeAlign(1));
+        llvm::Value* leading = builder.CreateSelect(builder.CreateICmpULT(precision, int_digits), precision, int_digits);
+        builder.CreateMemCpy(byte_at(buf, start), llvm::MaybeAlign(1), digit_buf, llvm::MaybeAlign(1), byte_count(builder, leading));
+        llvm::Value* point = builder.CreateAdd(start, int_digits);
+        builder.CreateStore(builder.getInt8('.'), byte_at(buf, point));
+        llvm::Value* after_point = builder.CreateAdd(point, builder.getInt32(1));
+        builder.CreateStore(builder.getInt8('0'), byte_at(buf, after_point));
+        llvm::Value* frac_digits = builder.CreateSub(precision, leading);
+        builder.CreateMemCpy(byte_at(buf, after_point), llvm::MaybeAlign(1), byte_at(digit_buf, leading), llvm::MaybeAlign(1), byte_count(builder, frac_digits));
+        llvm::Value* integral_end = builder.CreateAdd(after_point,
+            builder.CreateSelect(builder.CreateICmpEQ(frac_digits, builder.getInt32(0)), builder.getInt32(1), frac_digits));
+        builder.CreateBr(done);
+
+        // 0.00123
+        builder.SetInsertPoint(fraction);
+        builder.CreateStore(builder.getInt8('0'), byte_at(buf, start));
+        builder.CreateStore(builder.getInt8('.'), byte_at(buf, builder.CreateAdd(start, builder.getInt32(1))));
+        llvm::Value* zeros = builder.CreateSub(builder.getInt32(-1), final_exponent);
+        llvm::Value* zeros_at = builder.CreateAdd(start, builder.getInt32(2));
+        builder.CreateMemSet(byte_at(buf, zeros_at), builder.getInt8('0'), byte_count(builder, zeros), llvm::MaybeAlign(1));
+        llvm::Value* digits_at = builder.CreateAdd(zeros_at, zeros);
+        builder.CreateMemCpy(byte_at(buf, digits_at), llvm::MaybeAlign(1), digit_buf, llvm::MaybeAlign(1), byte_count(builder, precision));
+        llvm::Value* fraction_end = builder.CreateAdd(digits_at, precision);
+        builder.CreateBr(done);
+
+        // 1.5e+20, 1e-05: the point is left out (overwritten by the 'e') when there is one digit
+        builder.SetInsertPoint(scientific);
+        builder.CreateStore(builder.CreateLoad(i8, digit_buf), byte_at(buf, start));
+        builder.CreateStore(builder.getInt8('.'), byte_at(buf, builder.CreateAdd(start, builder.getInt32(1))));
+        builder.CreateMemCpy(byte_at(buf, builder.CreateAdd(start, builder.getInt32(2))), llvm::MaybeAlign(1),
+                             byte_at(digit_buf, builder.getInt32(1)), llvm::MaybeAlign(1), byte_count(builder, last_index));
+        llvm::Value* e_at = builder.CreateAdd(start, builder.CreateSelect(builder.CreateICmpUGT(precision, builder.getInt32(1)),
+                                                                          builder.CreateAdd(precision, builder.getInt32(1)), builder.getInt32(1)));
+        llvm::Value* negative_exponent = builder.CreateICmpSLT(final_exponent, builder.getInt32(0));
+        llvm::Value* abs_exponent = builder.CreateSelect(negative_exponent, builder.CreateNeg(final_exponent), final_exponent);
+        llvm::Value* tens = builder.CreateUDiv(abs_exponent, builder.getInt32(10));
+        llvm::Value* ones = builder.CreateSub(abs_exponent, builder.CreateMul(tens, builder.getInt32(10)));
+        builder.CreateStore(builder.getInt8('e'), byte_at(buf, e_at));
+        builder.CreateStore(builder.CreateSelect(negative_exponent, builder.getInt8('-'), builder.getInt8('+')),
+                            byte_at(buf, builder.CreateAdd(e_at, builder.getInt32(1))));
+        builder.CreateStore(builder.CreateTrunc(builder.CreateAdd(tens, builder.getInt32('0')), i8), byte_at(buf, builder.CreateAdd(e_at, builder.getInt32(2))));
+        builder.CreateStore(builder.CreateTrunc(builder.CreateAdd(ones, builder.getInt32('0')), i8), byte_at(buf, builder.CreateAdd(e_at, builder.getInt32(3))));
+        llvm::Value* scientific_end = builder.CreateAdd(e_at, builder.getInt32(4));
+        builder.CreateBr(done);
+
+        builder.SetInsertPoint(done);
+        llvm::PHINode* length = builder.CreatePHI(i32, 3, "length");
+        length->addIncoming(integral_end, integral);
+        length->addIncoming(fraction_end, fraction);
+        length->addIncoming(scientific_end, scientific);
+        builder.CreateStore(builder.getInt8(0), byte_at(buf, length));
+        builder.CreateRet(length);
+    });
+}
+
+// miaow.parse_int(data, len) -> value
+static llvm::Function* parse_int_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context),
+        {ptr_type(), llvm::Type::getInt32Ty(*session->context)}, false);
+    return runtime_function("miaow.parse_int", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::Value* data = func->getArg(0);
+        llvm::Value* len = func->getArg(1);
+        llvm::Type* i8 = builder.getInt8Ty();
+        llvm::Type* i32 = builder.getInt32Ty();
+        auto block = [&](const char* name) { return llvm::BasicBlock::Create(*session->context, name, func); };
+        llvm::BasicBlock* entry = builder.GetInsertBlock();
+        llvm::BasicBlock* skip = block("skip");
+        llvm::BasicBlock* skip_test = block("skip_test");
+        llvm::BasicBlock* skip_next = block("skip_next");
+        llvm::BasicBlock* empty = block("empty");
+        llvm::BasicBlock* sign = block("sign");
+        llvm::BasicBlock* digits = block("digits");
+        llvm::BasicBlock* digit_test = block("digit_test");
+        llvm::BasicBlock* accumulate = block("accumulate");
+        llvm::BasicBlock* done = block("done");
+        builder.CreateBr(skip);
+
+        // Whitespace: ' ' and \t \n \v \f \r
+        builder.SetInsertPoint(skip);
+        llvm::PHINode* i = builder.CreatePHI(i32, 2, "i");
+        i->addIncoming(builder.getInt32(0), entry);
+        builder.CreateCondBr(builder.CreateICmpSLT(i, len), skip_test, empty);
+
+        builder.SetInsertPoint(skip_test);
+        llvm::Value* c = builder.CreateLoad(i8, builder.CreateInBoundsGEP(i8, data, i), "c");
+        llvm::Value* space = builder.CreateOr(builder.CreateICmpEQ(c, builder.getInt8(' ')),
+                                              builder.CreateICmpULT(builder.CreateSub(c, builder.getInt8('\t')), builder.getInt8(5)));
+        builder.CreateCondBr(space, skip_next, sign);
+
+        builder.SetInsertPoint(skip_next);
+        i->addIncoming(builder.CreateAdd(i, builder.getInt32(1)), skip_next);
+        builder.CreateBr(skip);
+
+        builder.SetInsertPoint(empty);
+        builder.CreateRet(builder.getInt32(0));
+
+        builder.SetInsertPoint(sign);
+        llvm::Value* negative = builder.CreateICmpEQ(c, builder.getInt8('-'));
+        llvm::Value* has_sign = builder.CreateOr(negative, builder.CreateICmpEQ(c, builder.getInt8('+')));
+        llvm::Value* first = builder.CreateAdd(i, builder.CreateZExt(has_sign, i32));
+        builder.CreateBr(digits);
+
+        builder.SetInsertPoint(digits);
+        llvm::PHINode* j = builder.CreatePHI(i32, 2, "j");
+        llvm::PHINode* total = builder.CreatePHI(i32, 2, "total");
+        j->addIncoming(first, sign);
+        total->addIncoming(builder.getInt32(0), sign);
+        builder.CreateCondBr(builder.CreateICmpSLT(j, len), digit_test, done);
+
+        builder.SetInsertPoint(digit_test);
+        llvm::Value* digit = builder.CreateSub(builder.CreateLoad(i8, builder.CreateInBoundsGEP(i8, data, j)), builder.getInt8('0'));
+        builder.CreateCondBr(builder.CreateICmpULT(digit, builder.getInt8(10)), accumulate, done);
+
+        builder.SetInsertPoint(accumulate);
+        j->addIncoming(builder.CreateAdd(j, builder.getInt32(1)), accumulate);
+        total->addIncoming(builder.CreateAdd(builder.CreateMul(total, builder.getInt32(10)), builder.CreateZExt(digit, i32)), accumulate);
+        builder.CreateBr(digits);
+
+        builder.SetInsertPoint(done);
+        builder.CreateRet(builder.CreateSelect(negative, builder.CreateNeg(total), total));
+    });
+}
+
+// Make room for bytes more in the output buffer, writing it out first if they don't fit.
+// Returns where they go and how much of the buffer is in use before them.
+static std::pair<llvm::Value*, llvm::Value*> reserve_output(llvm::Function* func, llvm::IRBuilder<>& builder, unsigned bytes) {
+    llvm::GlobalVariable* used_var = output_used();
+    llvm::BasicBlock* full = llvm::BasicBlock::Create(*session->context, "full", func);
+    llvm::BasicBlock* room = llvm::BasicBlock::Create(*session->context, "room", func);
+    llvm::Value* used = builder.CreateLoad(builder.getInt32Ty(), used_var, "used");
+    builder.CreateCondBr(builder.CreateICmpULE(builder.CreateAdd(used, builder.getInt32(bytes)), builder.getInt32(OUTPUT_BUFFER_SIZE)), room, full);
+
+    builder.SetInsertPoint(full);
+    builder.CreateCall(flush_function());
+    builder.CreateBr(room);
+
+    builder.SetInsertPoint(room);
+    llvm::Value* start = builder.CreateLoad(builder.getInt32Ty(), used_var, "start");
+    return {builder.CreateInBoundsGEP(builder.getInt8Ty(), output_buffer(), start), start};
+}
+
+// miaow.write_str(data, len): append to the output buffer, like write_line without the newline
+static llvm::Function* write_str_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context),
+        {ptr_type(), llvm::Type::getInt32Ty(*session->context)}, false);
+    return runtime_function("miaow.write_str", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        llvm::GlobalVariable* used_var = output_used();
+        llvm::Value* data = func->getArg(0);
+        llvm::Value* len = func->getArg(1);
+        llvm::Value* capacity = builder.getInt32(OUTPUT_BUFFER_SIZE);
+
+        llvm::BasicBlock* full = llvm::BasicBlock::Create(*session->context, "full", func);
+        llvm::BasicBlock* direct = llvm::BasicBlock::Create(*session->context, "direct", func);
+        llvm::BasicBlock* copy = llvm::BasicBlock::Create(*session->context, "copy", func);
+
+        llvm::Value* used = builder.CreateLoad(builder.getInt32Ty(), used_var, "used");
+        builder.CreateCondBr(builder.CreateICmpULE(builder.CreateAdd(used, len), capacity), copy, full);
+
+        builder.SetInsertPoint(full);
+        builder.CreateCall(flush_function());
+        builder.CreateCondBr(builder.CreateICmpUGT(len, capacity), direct, copy);
+
+        builder.SetInsertPoint(direct);
+        builder.CreateCall(write_all_function(), {data, byte_count(builder, len)});
+        builder.CreateRetVoid();
+
+        builder.SetInsertPoint(copy);
+        llvm::Value* start = builder.CreateLoad(builder.getInt32Ty(), used_var, "start");
+        llvm::Value* dst = builder.CreateInBoundsGEP(builder.getInt8Ty(), output_buffer(), start);
+        builder.CreateMemCpy(dst, llvm::MaybeAlign(1), data, llvm::MaybeAlign(1), byte_count(builder, len));
+        builder.CreateStore(builder.CreateAdd(start, len), used_var);
+        builder.CreateRetVoid();
+    });
+}
+
+// miaow.write_char(c)
+static llvm::Function* write_char_function() {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context),
+        {llvm::Type::getInt8Ty(*session->context)}, false);
+    return runtime_function("miaow.write_char", FT, [](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        auto [dst, start] = reserve_output(func, builder, 1);
+        builder.CreateStore(func->getArg(0), dst);
+        builder.CreateStore(builder.CreateAdd(start, builder.getInt32(1)), output_used());
+        builder.CreateRetVoid();
+    });
+}
+
+// miaow.write_int(value) and miaow.write_float(value): format straight into the output buffer
+static llvm::Function* write_number_function(const std::string& name, llvm::Type* type, unsigned max_length,
+                                             llvm::Function* (*format_function)()) {
+    llvm::FunctionType* FT = llvm::FunctionType::get(llvm::Type::getVoidTy(*session->context), {type}, false);
+    return runtime_function(name, FT, [max_length, format_function](llvm::Function* func, llvm::IRBuilder<>& builder) {
+        auto [dst, start] = reserve_output(func, builder, max_length);
+        llvm::Value* written = builder.CreateCall(format_function(), {func->getArg(0), dst});
+        builder.CreateStore(builder.CreateAdd(start, written), output_used());
+        builder.CreateRetVoid();
+    });
+}
+
+void emit_write_line(llvm::Value* data, llvm::Value* len) {
+    if (unbuffered_output) {
+        llvm::FunctionType* puts_type = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context), {ptr_type()}, false);
+        llvm::FunctionCallee puts = session->module->getOrInsertFunction("puts", puts_type);
+        session->builder->CreateCall(puts, data);
+        return;
+    }
+    session->builder->CreateCall(write_line_function(), {data, len});
+}
+
+// fflush(NULL) flushes every stdio stream, without naming stdout (a different symbol on each libc)
+static void flush_stdio() {
+    llvm::FunctionType* fflush_type = llvm::FunctionType::get(llvm::Type::getInt32Ty(*session->context), {ptr_type()}, false);
+    llvm::FunctionCallee fflush = session->module->getOrInsertFunction("fflush", fflush_type);
+    session->builder->CreateCall(fflush, llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(*session->context)));
+}
+
+void emit_flush_output() {
+    if (unbuffered_output) {
+        flush_stdio();
+        return;
+    }
+    session->builder->CreateCall(flush_function());
+}
+
+void emit_write_str(llvm::Value* data, llvm::Value* len) {
+    session->builder->CreateCall(write_str_function(), {data, len});
+}
+
+void emit_write_char(llvm::Value* c) {
+    session->builder->CreateCall(write_char_function(), {c});
+}
+
+void emit_write_int(llvm::Value* value) {
+    session->builder->CreateCall(write_number_function("miaow.write_int", llvm::Type::getInt32Ty(*session->context),
+                                                       INT_STRING_SIZE, format_int_function), {value});
+}
+
+void emit_write_float(llvm::Value* value) {
+    session->builder->CreateCall(write_number_function("miaow.write_float", llvm::Type::getFloatTy(*session->context),
+                                                       FLOAT_STRING_SIZE, format_float_function), {value});
+}
+
+void emit_begin_line() {
+    // What earlier meows left in stdio goes first
+    if (unbuffered_output) flush_stdio();
+}
+
+void emit_end_line() {
+    emit_write_char(session->builder->getInt8('\n'));
+    if (unbuffered_output) session->builder->CreateCall(flush_function());
+}
+
+llvm::Value* emit_format_int(llvm::Value* value, llvm::Value* buf) {
+    return session->builder->CreateCall(format_int_function(), {value, buf});
+}
+
+llvm::Value* emit_format_float(llvm::Value* value, llvm::Value* buf) {
+    return session->builder->CreateCall(format_float_function(), {value, buf});
+}
+
+llvm::Value* emit_parse_int(llvm::Value* data, llvm::Value* len) {
+    return session->builder->CreateCall(parse_int_function(), {data, len});
+}
+
+void flush_output_before_returns(llvm::Function* func) {
+    // libc flushes its own buffers at exit
+    if (unbuffered_output) return;
+
+    std::vector<llvm::ReturnInst*> returns;
+    for (llvm::BasicBlock& block : *func) {
+        if (auto* ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+            returns.push_back(ret);
+        }
+    }
+    for (llvm::ReturnInst* ret : returns) {
+        llvm::IRBuilder<> builder(ret);
+        builder.CreateCall(flush_function());
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+#include "types.hpp"
+
+// The miaow runtime: support code that compiled programs call. It is emitted as IR into the
+// module being compiled, the first time a module needs it, so programs link and JIT without
+// a separate runtime library. Its globals and functions are linkonce_odr, so the copies in a
+// program, its --module objects and its --codegen-threads parts merge into one.
+
+// --unbuffered: meow calls puts for every line, as before the output buffer (defined in miaow.cpp)
+extern bool unbuffered_output;
+
+// Size of the output buffer that meow appends to
+constexpr unsigned OUTPUT_BUFFER_SIZE = 1 << 16;
+
+// Longest text of an Int and of a Float, with the NUL
+constexpr unsigned INT_STRING_SIZE = 12;
+constexpr unsigned FLOAT_STRING_SIZE = 32;
+
+// Print len bytes at data, and a newline. Buffered unless --unbuffered; a full buffer is written out first.
+void emit_write_line(llvm::Value* data, llvm::Value* len);
+
+// Write out everything printed so far: the output buffer, or libc's stdout buffers with --unbuffered
+void emit_flush_output();
+
+// A line printed by meowf: emit_begin_line, the pieces, then emit_end_line. The pieces are appended
+// to the output buffer even with --unbuffered; the line is then written out as soon as it ends.
+void emit_begin_line();
+void emit_write_str(llvm::Value* data, llvm::Value* len);
+void emit_write_char(llvm::Value* c);
+void emit_write_int(llvm::Value* value);
+void emit_write_float(llvm::Value* value);
+void emit_end_line();
+
+// Write the decimal form of an Int to buf (at least INT_STRING_SIZE bytes), NUL terminated, with a digit-pair table
+// instead of sprintf. Returns its length.
+llvm::Value* emit_format_int(llvm::Value* value, llvm::Value* buf);
+
+// Write the shortest decimal that reads back as the same Float to buf (at least FLOAT_STRING_SIZE bytes), NUL terminated:
+// 1.5, 100.0, 0.001, 1e+20, nan, -inf. Returns its length.
+llvm::Value* emit_format_float(llvm::Value* value, llvm::Value* buf);
+
+// Parse an Int like sscanf("%d"): leading whitespace, an optional sign, then digits. 0 if there are none.
+llvm::Value* emit_parse_int(llvm::Value* data, llvm::Value* len);
+
+// Flush the output before every return of func, so what main (or a REPL input) printed is written
+// when it finishes
+void flush_output_before_returns(llvm::Function* func);
+
+#endif // RUNTIME_HPP
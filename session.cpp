@@ -0,0 +1,20 @@
+#include "session.hpp"
+
+thread_local CompilerSession* session = nullptr;
+
+CompilerSession::CompilerSession(const std::string& module_name) : previous(session) {
+    context = std::make_unique<llvm::LLVMContext>();
+    module = std::make_unique<llvm::Module>(module_name, *context);
+    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+
+    session = this;
+    init_intrinsics();
+}
+
+CompilerSession::~CompilerSession() {
+    session = previous;
+}
+
+StructDef* Type::struct_def() const {
+    return session->cache(this).struct_def;
+}
@@ -0,0 +1,62 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "types.hpp"
+#include "intrinsics.hpp"
+#include "preprocessor.hpp"
+#include <map>
+
+// The parts of a Type that belong to one LLVMContext, kept per session
+struct TypeCache {
+    StructDef* struct_def = nullptr;           // Struct: set once the struct is declared
+    llvm::Type* llvm_type = nullptr;           // Built on first use by get_llvm_type
+    llvm::StructType* array_struct = nullptr;  // Built on first use by get_array_struct_type
+};
+
+// Everything one compilation creates and changes: the LLVM context and module being built,
+// the variables, structs, funs and overloads declared so far, and the AST.
+// A session is the current one of the thread that created it, so each thread can compile
+// its own file (miaow -j N). Only interned symbols and types are shared between sessions.
+class CompilerSession {
+public:
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    std::unique_ptr<llvm::IRBuilder<>> builder;
+
+    SymbolTable object_registry;
+    std::unordered_map<std::string, StructDef> struct_registry;
+    // Operator -> its overloads, by parameter types
+    std::unordered_map<std::string, std::map<std::vector<TypeRef>, Function*>> overload_registry;
+    std::unordered_map<std::string, Function> intrinsics;
+
+    llvm::Function* static_scope = nullptr;  // Function whose temporaries must stay alive after it returns (REPL inputs)
+    // Stack temporaries still live in the current function, keyed by the value that owns them
+    std::unordered_map<llvm::Value*, std::vector<llvm::AllocaInst*>> temporaries;
+    // Characters of each string literal in the module, by text
+    std::unordered_map<std::string, llvm::GlobalVariable*> string_literals;
+
+    AstArena ast_arena;
+    LineMap line_map;  // Of the source being compiled, for error positions
+
+    // A fresh context and an empty module named module_name, with the intrinsics registered.
+    // The session is current on this thread until it is destroyed.
+    explicit CompilerSession(const std::string& module_name);
+    ~CompilerSession();
+
+    CompilerSession(const CompilerSession&) = delete;
+    CompilerSession& operator=(const CompilerSession&) = delete;
+
+    TypeCache& cache(TypeRef type) {
+        if (type->id >= type_caches.size()) type_caches.resize(type->id + 1);
+        return type_caches[type->id];
+    }
+
+private:
+    std::vector<TypeCache> type_caches;  // By Type::id
+    CompilerSession* previous;  // Current on this thread before this one
+};
+
+// The session compiling on this thread
+extern thread_local CompilerSession* session;
+
+#endif // SESSION_HPP
@@ -1,24 +1,10 @@
 #include "types.hpp"
 #include "intrinsics.hpp"
+#include "session.hpp"
 
-// Global state definitions
-std::unordered_map<std::string, MemObject> object_registry;
-std::unordered_map<std::string, StructDef> struct_registry;
-std::unordered_map<std::string, std::vector<std::string>> overload_registry;
-std::unique_ptr<llvm::LLVMContext> TheContext;
-std::unique_ptr<llvm::Module> TheModule;
-std::unique_ptr<llvm::IRBuilder<>> Builder;
-
-// Type mapping definitions
-const std::unordered_map<std::string, std::string> NATIVE_TYPES = {
-    {"Int", "i32"},
-    {"Float", "float"},
-    {"Bool", "i1"},
-    {"Char", "i8"},
-    {"Str", "i8"},
-    {"Nil", "void"},
-    {"Var", "ptr"}
-}; 
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
 
 // Removed instruction maps
 const std::unordered_map<std::string, std::string> ARITH_INSTRUCTIONS = {
@@ -41,101 +27,280 @@ const std::unordered_map<std::string, std::string> UNARY_STRING = {
 }; 
 
 
-Atom::Atom(std::string i) : identifier(i), stored_in(nullptr), len(0) {
-    if (!identifier.empty() && identifier[0] == '"') {
-        len = identifier.size()-1;
-        identifier.pop_back();
+// The symbol and type tables are shared by every session. They only lock once sessions
+// may run on several threads (miaow -j), so a single compile doesn't pay for it.
+static std::atomic<bool> tables_shared{false};
+
+void share_tables_between_threads() {
+    tables_shared = true;
+}
+
+class TableLock {
+public:
+    explicit TableLock(std::mutex& m) : mutex(tables_shared.load(std::memory_order_relaxed) ? &m : nullptr) {
+        if (mutex) mutex->lock();
+    }
+    ~TableLock() {
+        if (mutex) mutex->unlock();
+    }
+
+private:
+    std::mutex* mutex;
+};
+
+// Symbol table: lookups take a string_view, so interning an existing name allocates nothing.
+// Split into shards by hash, each with its own lock, so threads rarely wait for each other.
+struct SymbolHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+};
+
+struct SymbolShard {
+    std::mutex mutex;
+    std::unordered_set<std::string, SymbolHash, std::equal_to<>> names;
+};
+
+static constexpr size_t SYMBOL_SHARDS = 16;
+
+static SymbolShard& symbol_shard(std::string_view s) {
+    static SymbolShard shards[SYMBOL_SHARDS];
+    return shards[SymbolHash()(s) % SYMBOL_SHARDS];
+}
+
+Symbol::Symbol(std::string_view s) {
+    SymbolShard& shard = symbol_shard(s);
+    TableLock lock(shard.mutex);
+    auto it = shard.names.find(s);
+    if (it == shard.names.end()) {
+        it = shard.names.emplace(s).first;
+    }
+    interned = &*it;
+}
+
+std::ostream& operator<<(std::ostream& os, const Symbol& s) {
+    return os << s.str();
+}
+
+// Type table: each Type is created once and lives as long as the process
+static std::mutex type_mutex;
+
+static std::unordered_map<const std::string*, std::unique_ptr<Type>>& type_table() {
+    static std::unordered_map<const std::string*, std::unique_ptr<Type>> table;
+    return table;
+}
+
+// Intern a type by its name; make builds it the first time the name is seen
+static TypeRef intern_type(Symbol name, const std::function<Type*()>& make) {
+    {
+        TableLock lock(type_mutex);
+        auto it = type_table().find(&name.str());
+        if (it != type_table().end()) return it->second.get();
+    }
+
+    // make may intern the types this one is built from, so it runs without the lock
+    std::unique_ptr<Type> made(make());
+    TableLock lock(type_mutex);
+    std::unique_ptr<Type>& slot = type_table()[&name.str()];
+    if (!slot) {
+        made->id = type_table().size() - 1;
+        slot = std::move(made);
+    }
+    return slot.get();
+}
+
+static const std::unordered_map<std::string, TypeKind> BUILTIN_TYPES = {
+    {"Int", TypeKind::Int},
+    {"Float", TypeKind::Float},
+    {"Bool", TypeKind::Bool},
+    {"Char", TypeKind::Char},
+    {"Str", TypeKind::Str},
+    {"Nil", TypeKind::Nil},
+    {"Var", TypeKind::Var}
+};
+
+TypeRef lookup_type(std::string_view name) {
+    Symbol symbol(name);
+    return intern_type(symbol, [&]() {
+        auto builtin = BUILTIN_TYPES.find(symbol);
+        if (builtin != BUILTIN_TYPES.end()) {
+            Type* type = new Type(builtin->second, symbol);
+            if (type->kind == TypeKind::Str) {
+                type->element = lookup_type("Char");
+            }
+            return type;
+        }
+        if (name.size() >= 7 && name.substr(0, 6) == "Array<" && name.back() == '>') {
+            Type* type = new Type(TypeKind::Array, symbol);
+            type->element = lookup_type(name.substr(6, name.size() - 7));
+            return type;
+        }
+        // Any other name is a struct; struct_def is filled in when it is declared
+        return new Type(TypeKind::Struct, symbol);
+    });
+}
+
+TypeRef array_type_of(TypeRef element) {
+    return lookup_type("Array<" + element->name.str() + ">");
+}
+
+TypeRef function_type(TypeRef return_type, const std::vector<TypeRef>& param_types) {
+    // Keyed by a signature string like (Int Str)->Int
+    std::string signature = "(";
+    for (size_t i = 0; i < param_types.size(); i++) {
+        if (i) signature += " ";
+        signature += param_types[i] ? param_types[i]->name.str() : "Var";
+    }
+    signature += ")->" + (return_type ? return_type->name.str() : "Nil");
+
+    Symbol symbol(signature);
+    return intern_type(symbol, [&]() {
+        Type* type = new Type(TypeKind::Function, symbol);
+        type->return_type = return_type;
+        type->param_types = param_types;
+        return type;
+    });
+}
+
+const TypeRef INT_TYPE = lookup_type("Int");
+const TypeRef FLOAT_TYPE = lookup_type("Float");
+const TypeRef BOOL_TYPE = lookup_type("Bool");
+const TypeRef CHAR_TYPE = lookup_type("Char");
+const TypeRef STR_TYPE = lookup_type("Str");
+const TypeRef NIL_TYPE = lookup_type("Nil");
+const TypeRef VAR_TYPE = lookup_type("Var");
+
+TypeRef array_element_type(TypeRef array_type) {
+    if (array_type && array_type->element) {
+        return array_type->element;
+    }
+    return VAR_TYPE;
+}
 
-        identifier = identifier.substr(1);
-        type = "Str";
+bool is_struct_type(TypeRef type) {
+    return type && type->kind == TypeKind::Struct && type->struct_def();
+}
+
+List AstArena::store(std::vector<Particle>& nodes, size_t from) {
+    size_t count = nodes.size() - from;
+    if (count == 0) return {};
+
+    // A block never reallocates: a run that doesn't fit starts a new block
+    if (blocks.empty() || blocks.back().capacity() - blocks.back().size() < count) {
+        blocks.emplace_back();
+        blocks.back().reserve(std::max(count, BLOCK_NODES));
+    }
+    std::vector<Particle>& block = blocks.back();
+    size_t first = block.size();
+    block.insert(block.end(), std::make_move_iterator(nodes.begin() + from), std::make_move_iterator(nodes.end()));
+    nodes.erase(nodes.begin() + from, nodes.end());
+    return List(block.data() + first, count);
+}
+
+Atom::Atom(std::string_view text) : stored_in(), len(0) {
+    if (!text.empty() && text[0] == '"') {
+        len = text.size()-1;
+        identifier = text.substr(1, text.size() - 2);
+        type = STR_TYPE;
+        quoted = true;
     } else {
         // Check for Type:object syntax (e.g., Int:b, Char:33)
-        auto colon = identifier.find(':');
-        if (colon != std::string::npos && colon > 0 && std::isupper(identifier[0])) {
-            type = identifier.substr(0, colon);
-            identifier = identifier.substr(colon + 1);
+        auto colon = text.find(':');
+        if (colon != std::string_view::npos && colon > 0 && std::isupper(text[0])) {
+            type = lookup_type(text.substr(0, colon));
+            text = text.substr(colon + 1);
         }
         
         // Check for member access syntax (e.g., bob>name)
         // Only if identifier starts with lowercase (variable name), not operators like ->
-        auto arrow = identifier.find('>');
-        if (arrow != std::string::npos && arrow > 0 && std::islower(identifier[0])) {
-            member_access = identifier.substr(arrow + 1);
-            identifier = identifier.substr(0, arrow);
+        auto arrow = text.find('>');
+        if (arrow != std::string_view::npos && arrow > 0 && std::islower(text[0])) {
+            member_access = text.substr(arrow + 1);
+            text = text.substr(0, arrow);
         }
+        identifier = text;
     }
 }
 
-void Atom::set_type() {
-    type = get_type(true);
-}
-
-std::string Atom::get_type(bool native) {
-    if (!type.empty()) {
-        if (type == "Str") {
-            return native ? "ptr" : "Str";
-        }
-        if (struct_registry.count(type)) {
-            return native ? "ptr" : type;
-        }
-        if (NATIVE_TYPES.count(type)) {
-            return native ? NATIVE_TYPES.at(type) : type;
-        }
-        return native ? "ptr" : type;
+TypeRef Atom::get_type() {
+    if (type) {
+        return type;
     }
     if (!identifier.empty() && (isdigit(identifier[0]) || (identifier[0] == '-' && identifier.size() > 1 && isdigit(identifier[1])))) {
-        if (identifier.find('.') == std::string::npos) return (native) ? "i32" : "Int";
-        else return (native) ? "float" : "Float";
+        if (identifier.str().find('.') == std::string::npos) return INT_TYPE;
+        else return FLOAT_TYPE;
     } else if (identifier == "true" || identifier == "false") {
-        return (native) ? "i1" : "Bool";
+        return BOOL_TYPE;
     } else if (identifier == "nil") {
-        return (native) ? "void" : "Nil";
-    } else if (identifier[0] == '\"' || type == "Str") {
-        return (native) ? "ptr" : "Str";
-    } else if (object_registry.count(identifier)) {
-        std::string registered_type = object_registry.at(identifier).type;
-        if (struct_registry.count(registered_type)) {
-            return native ? "ptr" : registered_type;
-        }
-        if (NATIVE_TYPES.count(registered_type)) {
-            return native ? NATIVE_TYPES.at(registered_type) : registered_type;
-        }
-        return native ? "ptr" : registered_type;
+        return NIL_TYPE;
+    } else if (identifier[0] == '\"') {
+        return STR_TYPE;
+    } else if (MemObject* var = session->object_registry.find(identifier)) {
+        return var->type ? var->type : VAR_TYPE;
     }
-    return (native) ? "ptr" : "Var";
+    return VAR_TYPE;
 }
 
-// Molecule implementation
-Molecule::Molecule(List a, bool e) : atoms(a), stored_in(nullptr), eval(e) {}
-Molecule::Molecule(bool e) : atoms(), stored_in(nullptr), eval(e) {}
+void SymbolTable::push_scope() {
+    scope_starts.push_back(bindings.size());
+}
 
-Particle& Molecule::subject() {
-    return atoms.front();
+void SymbolTable::pop_scope() {
+    size_t start = scope_starts.back();
+    scope_starts.pop_back();
+    while (bindings.size() > start) {
+        Binding& binding = bindings.back();
+        if (binding.shadowed == NONE) {
+            innermost.erase(binding.name);
+        } else {
+            innermost[binding.name] = binding.shadowed;
+        }
+        bindings.pop_back();
+    }
 }
 
-List Molecule::predicate() {
-    if (atoms.size() <= 1) return {};
-    else {
-        auto start = atoms.begin() + 1;
-        auto end = atoms.end();
-        return List(start, end);
+void SymbolTable::define(const Symbol& name, const MemObject& object) {
+    const std::string* key = &name.str();
+    auto current = innermost.find(key);
+    if (current != innermost.end() && bindings[current->second].depth == scope_starts.size()) {
+        bindings[current->second].object = object;
+        return;
     }
+    size_t shadowed = current != innermost.end() ? current->second : NONE;
+    bindings.push_back({key, object, scope_starts.size(), shadowed});
+    innermost[key] = bindings.size() - 1;
 }
 
-void Molecule::add_atom(std::string identifier) {
-    atoms.push_back(Particle(Atom(identifier)));
+MemObject* SymbolTable::find(const Symbol& name) {
+    auto current = innermost.find(&name.str());
+    return current != innermost.end() ? &bindings[current->second].object : nullptr;
 }
 
-Molecule* Molecule::add_molecule(std::string identifier) {
-    Molecule m({}, true);
-    m.add_atom(identifier);
-    atoms.push_back(Particle(m));
-    return std::get_if<Molecule>(&atoms.back());
+MemObject* SymbolTable::find_local(const Symbol& name) {
+    auto current = innermost.find(&name.str());
+    if (current == innermost.end() || bindings[current->second].depth != scope_starts.size()) return nullptr;
+    return &bindings[current->second].object;
 }
 
-Molecule* Molecule::add_molecule(Molecule m) {
-    atoms.push_back(Particle(m));
-    return std::get_if<Molecule>(&atoms.back());
+void SymbolTable::clear() {
+    bindings.clear();
+    innermost.clear();
+    scope_starts.clear();
+}
+
+// Molecule implementation
+Molecule::Molecule(List a, bool e) : atoms(std::move(a)), stored_in(), eval(e) {}
+Molecule::Molecule(bool e) : atoms(), stored_in(), eval(e) {}
+
+Particle& Molecule::subject() {
+    return atoms.front();
+}
+
+const Particle& Molecule::subject() const {
+    return atoms.front();
+}
+
+List Molecule::predicate() {
+    return atoms.slice(1);
 }
 
 std::string Molecule::indent(int n, int nc, char c) {
@@ -177,107 +342,169 @@ void Molecule::print_tree(int deep) {
     }
 }
 
-std::string Molecule::get_type(bool native) {
-    std::string t = type.empty() ? get_type() : type;
-    if (native) {
-        if (struct_registry.count(t)) return "ptr";
-        if (NATIVE_TYPES.count(t)) return NATIVE_TYPES.at(t);
-        return "ptr";
-    }
-    return t;
-} 
-
-std::string Molecule::get_type() {
-    if (!type.empty()) return type;
+TypeRef Molecule::get_type() {
+    if (type) return type;
     
-    std::string identifier = std::get<Atom>(atoms.front()).identifier;
-    
-    if (INTRINSICS.count(identifier)) {
-        std::vector<Particle> args;
-        if (atoms.size() > 1) {
-            args.insert(args.end(), atoms.begin() + 1, atoms.end());
-        }
-        type = INTRINSICS[identifier].type_inference(args);
+    Function* fn = resolve_call(*this);
+    if (fn) {
+        type = fn->type_inference(predicate());
     } else {
-        type = "Nil";
+        type = NIL_TYPE;
     }
 
     return type;
 }
 
 // Utility function implementations
-std::string get_particle_type(Particle p) {
-    std::string type;
+TypeRef get_particle_type(Particle& p) {
+    TypeRef type = nullptr;
     std::visit([&type](auto&& particle) {
-        type = particle.get_type(false);
-    }, p);
-    return type;
-}
-
-std::string get_particle_type(Particle p, bool native) {
-    std::string type;
-    std::visit([&type, &native](auto&& particle) {
-        type = particle.get_type(native);
+        type = particle.get_type();
     }, p);
     return type;
 }
 
-llvm::Value* get_stored_in(Particle p) {
-    llvm::Value* val = nullptr;
+StoredValue get_stored_in(const Particle& p) {
+    StoredValue val;
     std::visit([&val](auto&& particle) {
         val = particle.stored_in;
     }, p);
     return val;
 }
 
-llvm::Type* get_llvm_type(const std::string& type_name) {
-    if (type_name == "Int") return llvm::Type::getInt32Ty(*TheContext);
-    if (type_name == "Float") return llvm::Type::getFloatTy(*TheContext);
-    if (type_name == "Bool") return llvm::Type::getInt1Ty(*TheContext);
-    if (type_name == "Char") return llvm::Type::getInt8Ty(*TheContext);
-    if (type_name == "Nil") return llvm::Type::getVoidTy(*TheContext);
-    if (type_name == "Str") return llvm::PointerType::getUnqual(*TheContext);
-    if (struct_registry.count(type_name)) return llvm::PointerType::getUnqual(*TheContext);
-    return llvm::PointerType::getUnqual(*TheContext);
+llvm::Type* get_llvm_type(TypeRef type) {
+    if (!type) return llvm::PointerType::getUnqual(*session->context);
+    llvm::Type*& cached = session->cache(type).llvm_type;
+    if (cached) return cached;
+
+    switch (type->kind) {
+        case TypeKind::Int: cached = llvm::Type::getInt32Ty(*session->context); break;
+        case TypeKind::Float: cached = llvm::Type::getFloatTy(*session->context); break;
+        case TypeKind::Bool: cached = llvm::Type::getInt1Ty(*session->context); break;
+        case TypeKind::Char: cached = llvm::Type::getInt8Ty(*session->context); break;
+        case TypeKind::Nil: cached = llvm::Type::getVoidTy(*session->context); break;
+        // Str, arrays, structs, functions and Var are all handled through a pointer
+        default: cached = llvm::PointerType::getUnqual(*session->context); break;
+    }
+    return cached;
+}
+
+llvm::Type* get_storage_type(TypeRef type) {
+    if (is_struct_type(type) && type->struct_def()->is_extern) {
+        return type->struct_def()->llvm_type;
+    }
+    return get_llvm_type(type);
 }
 
 llvm::Constant* get_llvm_constant(Atom& atom) {
-    if (atom.type.empty()) {
-        atom.type = atom.get_type(false);
+    if (!atom.type) {
+        atom.type = atom.get_type();
     }
 
-    if (atom.type == "Int") {
+    if (atom.type == INT_TYPE) {
         // Only parse if it's actually a numeric literal
         if (!atom.identifier.empty() && (isdigit(atom.identifier[0]) || (atom.identifier[0] == '-' && atom.identifier.size() > 1 && isdigit(atom.identifier[1])))) {
-            return llvm::ConstantInt::get(*TheContext, llvm::APInt(32, std::stoi(atom.identifier)));
+            return llvm::ConstantInt::get(*session->context, llvm::APInt(32, std::stoi(atom.identifier)));
         }
         return nullptr;  // Variable reference, not a literal
     }
-    if (atom.type == "Float") {
+    if (atom.type == FLOAT_TYPE) {
         // Only parse if it's actually a numeric literal
         if (!atom.identifier.empty() && (isdigit(atom.identifier[0]) || (atom.identifier[0] == '-' && atom.identifier.size() > 1 && isdigit(atom.identifier[1])))) {
-            return llvm::ConstantFP::get(*TheContext, llvm::APFloat(std::stof(atom.identifier)));
+            return llvm::ConstantFP::get(*session->context, llvm::APFloat(std::stof(atom.identifier)));
         }
         return nullptr;  // Variable reference, not a literal
     }
-    if (atom.type == "Char") {
+    if (atom.type == CHAR_TYPE) {
         // Char:33 means character with ASCII code 33, or Char:'!' for literal char
         if (!atom.identifier.empty() && isdigit(atom.identifier[0])) {
-            return llvm::ConstantInt::get(*TheContext, llvm::APInt(8, std::stoi(atom.identifier)));
+            return llvm::ConstantInt::get(*session->context, llvm::APInt(8, std::stoi(atom.identifier)));
         }
         return nullptr;
     }
-    if (atom.type == "Bool") {
-        return llvm::ConstantInt::get(*TheContext, llvm::APInt(1, atom.identifier == "true" ? 1 : 0));
+    if (atom.type == BOOL_TYPE) {
+        return llvm::ConstantInt::get(*session->context, llvm::APInt(1, atom.identifier == "true" ? 1 : 0));
     }
     // Str is now handled specially in evaluate() to build array struct
     return nullptr;
 }
 
-llvm::StructType* get_array_struct_type(llvm::Type* element_type) {
+llvm::StructType* get_array_struct_type(TypeRef array_type) {
+    llvm::StructType*& cached = session->cache(array_type).array_struct;
+    if (cached) return cached;
+
     std::vector<llvm::Type*> members;
-    members.push_back(llvm::Type::getInt32Ty(*TheContext)); // size
-    members.push_back(llvm::Type::getInt32Ty(*TheContext)); // capacity
-    members.push_back(llvm::PointerType::getUnqual(element_type)); // data pointer
-    return llvm::StructType::get(*TheContext, members);
+    members.push_back(llvm::Type::getInt32Ty(*session->context)); // size
+    members.push_back(llvm::Type::getInt32Ty(*session->context)); // capacity
+    members.push_back(llvm::PointerType::getUnqual(*session->context)); // data pointer
+    cached = llvm::StructType::get(*session->context, members);
+    return cached;
+}
+
+llvm::AllocaInst* create_entry_alloca(llvm::Type* type, const std::string& name) {
+    // Allocas in the entry block are static: one stack slot per site, promotable by mem2reg
+    llvm::Function* func = session->builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock& entry = func->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+    return entry_builder.CreateAlloca(type, nullptr, name);
+}
+
+llvm::Value* create_temporary(llvm::Type* type, const std::string& name, llvm::Value* owner) {
+    if (session->builder->GetInsertBlock()->getParent() == session->static_scope) {
+        // e.g. a REPL (def Str:s "hey") must still point at valid memory in the next input
+        return new llvm::GlobalVariable(*session->module, type, false, llvm::GlobalValue::PrivateLinkage,
+                                        llvm::Constant::getNullValue(type), name);
+    }
+
+    llvm::AllocaInst* slot = create_entry_alloca(type, name);
+    // The slot's contents start fresh at every evaluation (e.g. each loop iteration)
+    session->builder->CreateLifetimeStart(slot);
+    session->temporaries[owner ? owner : slot].push_back(slot);
+    return slot;
+}
+
+llvm::GlobalVariable* string_literal(const std::string& text) {
+    llvm::GlobalVariable*& literal = session->string_literals[text];
+    if (!literal) {
+        llvm::Constant* chars = llvm::ConstantDataArray::getString(*session->context, text);
+        literal = new llvm::GlobalVariable(*session->module, chars->getType(), true, llvm::GlobalValue::PrivateLinkage, chars, "str");
+        literal->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    }
+    return literal;
+}
+
+bool copy_constant_literal(llvm::Value* slot, llvm::Type* aggregate_type, const std::vector<llvm::Value*>& values) {
+    std::vector<llvm::Constant*> constants;
+    for (llvm::Value* value : values) {
+        llvm::Constant* constant = llvm::dyn_cast<llvm::Constant>(value);
+        if (!constant) return false;
+        constants.push_back(constant);
+    }
+
+    llvm::Constant* init = nullptr;
+    if (auto* struct_type = llvm::dyn_cast<llvm::StructType>(aggregate_type)) {
+        if (constants.size() != struct_type->getNumElements()) return false;
+        init = llvm::ConstantStruct::get(struct_type, constants);
+    } else {
+        init = llvm::ConstantArray::get(llvm::cast<llvm::ArrayType>(aggregate_type), constants);
+    }
+    auto* literal = new llvm::GlobalVariable(*session->module, aggregate_type, true, llvm::GlobalValue::PrivateLinkage,
+                                             init, "literal");
+    literal->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    session->builder->CreateMemCpy(slot, llvm::MaybeAlign(), literal, llvm::MaybeAlign(), llvm::ConstantExpr::getSizeOf(aggregate_type));
+    return true;
+}
+
+void release_temporary(const StoredValue& v) {
+    if (!v || v.is_address) return;
+    auto it = session->temporaries.find(v.value);
+    if (it == session->temporaries.end()) return;
+    for (llvm::AllocaInst* slot : it->second) {
+        session->builder->CreateLifetimeEnd(slot);
+    }
+    session->temporaries.erase(it);
+}
+
+void clear_temporaries() {
+    session->temporaries.clear();
 }
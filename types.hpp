@@ -23,7 +23,6 @@
 #define WHITESPACE "\n\t "
 
 // Type mappings
-extern const std::unordered_map<std::string, std::string> NATIVE_TYPES;
 extern const std::unordered_map<std::string, std::string> ARITH_INSTRUCTIONS;
 extern const std::unordered_map<std::string, std::string> FLOAT_ARITH_INSTRUCTIONS;
 extern const std::unordered_map<std::string, std::string> COMPARE_INSTRUCTIONS;
@@ -31,82 +30,265 @@ extern const std::unordered_map<std::string, std::string> FLOAT_COMPARE_INSTRUCT
 extern const std::unordered_map<std::string, std::string> LOGIC_INSTRUCTIONS;
 extern const std::unordered_map<std::string, std::string> UNARY_STRING;
 
+// An interned string: each distinct name or type name is stored once in the symbol table,
+// so a Symbol is a single pointer and comparing two Symbols is a pointer compare
+class Symbol {
+public:
+    Symbol() : Symbol(std::string_view()) {}
+    Symbol(std::string_view s);
+    Symbol(const std::string& s) : Symbol(std::string_view(s)) {}
+    Symbol(const char* s) : Symbol(std::string_view(s)) {}
+
+    const std::string& str() const { return *interned; }
+    operator const std::string&() const { return *interned; }
+
+    bool empty() const { return interned->empty(); }
+    size_t size() const { return interned->size(); }
+    char operator[](size_t i) const { return (*interned)[i]; }
+
+    bool operator==(const Symbol& other) const { return interned == other.interned; }
+    bool operator==(const std::string& s) const { return *interned == s; }
+    bool operator==(const char* s) const { return *interned == s; }
+
+private:
+    const std::string* interned;
+};
+
+std::ostream& operator<<(std::ostream& os, const Symbol& s);
+
+struct StructDef;
+
+enum class TypeKind { Int, Float, Bool, Char, Str, Nil, Var, Array, Struct, Function };
+
+// A miaow type. Types are interned in the type table (one Type per distinct type),
+// so checking a type is a pointer compare against a handle like INT_TYPE.
+// The table is shared by all sessions; what depends on a session's LLVMContext
+// (struct definition, LLVM types) is kept in the session, under the type's id.
+class Type {
+public:
+    TypeKind kind;
+    Symbol name;                         // as written in source: Int, Array<Int>, Person
+    const Type* element = nullptr;       // Array<T>: T; Str: Char
+    const Type* return_type = nullptr;   // Function: signature
+    std::vector<const Type*> param_types;
+    unsigned id = 0;                     // Index of the type in the table
+
+    Type(TypeKind k, Symbol n) : kind(k), name(n) {}
+
+    // Struct: its definition in the current session, null until the struct is declared
+    StructDef* struct_def() const;
+};
+
+typedef const Type* TypeRef;
+
+extern const TypeRef INT_TYPE;
+extern const TypeRef FLOAT_TYPE;
+extern const TypeRef BOOL_TYPE;
+extern const TypeRef CHAR_TYPE;
+extern const TypeRef STR_TYPE;
+extern const TypeRef NIL_TYPE;
+extern const TypeRef VAR_TYPE;
+
+// Call before compiling on more than one thread: from then on the symbol and type tables lock
+void share_tables_between_threads();
+
+// The type named in source (e.g. Int, Array<Str>, Person); other names are struct types
+TypeRef lookup_type(std::string_view name);
+TypeRef array_type_of(TypeRef element);
+TypeRef function_type(TypeRef return_type, const std::vector<TypeRef>& param_types);
+
+// Element type of Array<T> or Str, Var for anything else
+TypeRef array_element_type(TypeRef array_type);
+
+// Whether a type is a declared struct (type may be null)
+bool is_struct_type(TypeRef type);
+
 // Memory object for tracking variables
 class MemObject {
 public:
-    std::string type;
+    TypeRef type;
     llvm::Value* value;
 
-    MemObject() : type(), value(nullptr) {}
-    MemObject(std::string t, llvm::Value* v) : type(t), value(v) {}
+    MemObject() : type(nullptr), value(nullptr) {}
+    MemObject(TypeRef t, llvm::Value* v) : type(t), value(v) {}
+};
+
+// Variables visible at the current point of codegen. Funs and blocks push a scope;
+// a name resolves to its innermost definition. Bindings live on one stack with an
+// index of each name's innermost binding, so scopes, lookups and shadowing are O(1).
+class SymbolTable {
+public:
+    void push_scope();
+    void pop_scope();  // Forgets every binding made since the matching push_scope
+
+    // Bind name in the innermost scope, replacing a binding made there before
+    void define(const Symbol& name, const MemObject& object);
+
+    // The innermost binding of name, or nullptr. Invalidated by the next define.
+    MemObject* find(const Symbol& name);
+    // Only a binding made in the innermost scope
+    MemObject* find_local(const Symbol& name);
+
+    void clear();
+
+private:
+    struct Binding {
+        const std::string* name;
+        MemObject object;
+        size_t depth;
+        size_t shadowed;  // Index of the binding this one hides, or NONE
+    };
+    static constexpr size_t NONE = SIZE_MAX;
+
+    std::vector<Binding> bindings;
+    std::unordered_map<const std::string*, size_t> innermost;  // Interned name -> index in bindings
+    std::vector<size_t> scope_starts;
 };
 
 // Struct definition
 struct StructDef {
     std::string name;
     std::vector<std::string> field_names;
-    std::vector<std::string> field_types;
+    std::vector<TypeRef> field_types;
     llvm::StructType* llvm_type;
     bool is_extern = false;  // External C structs are passed by value
 };
 
-// Global state
-extern std::unordered_map<std::string, MemObject> object_registry;
-extern std::unordered_map<std::string, StructDef> struct_registry;
-extern std::unordered_map<std::string, std::vector<std::string>> overload_registry;
-extern std::unique_ptr<llvm::LLVMContext> TheContext;
-extern std::unique_ptr<llvm::Module> TheModule;
-extern std::unique_ptr<llvm::IRBuilder<>> Builder;
+// A compiled particle's value: either an SSA rvalue held in a register,
+// or the address of the memory it lives in (variables, struct fields).
+// Only real storage is addressed; intermediate results stay in registers.
+struct StoredValue {
+    llvm::Value* value = nullptr;
+    bool is_address = false;
+
+    StoredValue() = default;
+    StoredValue(llvm::Value* v, bool address) : value(v), is_address(address) {}
+
+    static StoredValue rvalue(llvm::Value* v) { return StoredValue(v, false); }
+    static StoredValue address(llvm::Value* v) { return StoredValue(v, true); }
+
+    explicit operator bool() const { return value != nullptr; }
+};
 
 // Forward declarations
 class Molecule;
 typedef std::variant<class Atom, Molecule> Particle;
-typedef std::vector<Particle> List;
+class Function;
+
+// The children of a Molecule: a contiguous run of nodes owned by the AST arena
+class List {
+public:
+    List() = default;
+    List(Particle* first, size_t count) : first(first), count(count) {}
+
+    Particle* begin() const;
+    Particle* end() const;
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Particle& operator[](size_t i) const;
+    Particle& front() const { return *first; }
+
+    // The nodes from index `from` on
+    List slice(size_t from) const;
+
+private:
+    Particle* first = nullptr;
+    size_t count = 0;
+};
 
 // Atom class - represents a single token/value
 class Atom {
 public:
-    std::string identifier;
-    llvm::Value* stored_in;
-    std::string type;
-    std::string member_access;  // For x>field syntax
+    Symbol identifier;
+    StoredValue stored_in;
+    TypeRef type = nullptr;  // Type annotation (Int:x) or the type it was resolved to
+    Symbol member_access;  // For x>field syntax
     int len;
+    int line = 0;  // Source position (1-based), 0 if not from source
+    int col = 0;
+    bool quoted = false;  // String literal; identifier holds its text
+    bool borrowed = false;  // String literal its consumer only reads (Function::borrows_args), so it isn't copied
 
-    Atom(std::string i);
-    void set_type();
-    std::string get_type(bool native = true);
+    Atom(std::string_view text);
+    TypeRef get_type();
 };
 
 // Molecule class - represents an S-expression
 class Molecule {
 public:
     List atoms;
-    llvm::Value* stored_in;
-    std::string type;
+    StoredValue stored_in;
+    TypeRef type = nullptr;  // Type annotation (Int:(...)) or the inferred type, once known
+    Function* callee = nullptr;  // Intrinsic, fun or overload this call dispatches to, set by the type pass
     bool eval = true;
+    int line = 0;  // Position of the opening bracket (1-based), 0 if not from source
+    int col = 0;
 
     Molecule(List a, bool e = true);
     Molecule(bool e = true);
 
     Particle& subject();
+    const Particle& subject() const;
     List predicate();
-    void add_atom(std::string identifier);
-    Molecule* add_molecule(std::string identifier);
-    Molecule* add_molecule(Molecule m);
     std::string indent(int n, int nc = 4, char c = ' ');
     void print_tree(int deep = 0);
-    std::string get_type(bool native);
-    std::string get_type();
+    TypeRef get_type();
+};
+
+inline Particle* List::begin() const { return first; }
+inline Particle* List::end() const { return first + count; }
+inline Particle& List::operator[](size_t i) const { return first[i]; }
+inline List List::slice(size_t from) const {
+    return from >= count ? List() : List(first + from, count - from);
+}
+
+// Storage for AST nodes. Nodes are appended in large blocks and never move or get freed
+// one by one, so a Molecule's children are just a pointer and a count into a block.
+class AstArena {
+public:
+    // Move nodes[from..] into the arena as one run, remove them from nodes and return the run
+    List store(std::vector<Particle>& nodes, size_t from);
+    // Release every node; Lists handed out before are invalid afterwards
+    void clear() { blocks.clear(); }
+
+private:
+    static constexpr size_t BLOCK_NODES = 4096;
+    std::vector<std::vector<Particle>> blocks;
 };
 
 // Utility functions
-std::string get_particle_type(Particle p);
-std::string get_particle_type(Particle p, bool native);
-llvm::Value* get_stored_in(Particle p);
+TypeRef get_particle_type(Particle& p);
+StoredValue get_stored_in(const Particle& p);
 
-llvm::Type* get_llvm_type(const std::string& type_name);
+// LLVM type of a value: scalars directly, Str/arrays/structs as a pointer (cached on the type)
+llvm::Type* get_llvm_type(TypeRef type);
+// Type of a variable's storage: like get_llvm_type, but extern structs are held by value
+llvm::Type* get_storage_type(TypeRef type);
 llvm::Constant* get_llvm_constant(Atom& atom);
 
-llvm::StructType* get_array_struct_type(llvm::Type* element_type);
+// {size, capacity, data} header of a Str or Array<T> (cached on the type)
+llvm::StructType* get_array_struct_type(TypeRef array_type);
+
+// Stack slots: every compiler-created alloca goes through the entry block of the current function
+llvm::AllocaInst* create_entry_alloca(llvm::Type* type, const std::string& name = "");
+
+// A per-evaluation temporary (literal or conversion result) in an entry-block slot.
+// Its lifetime starts here; slots that back the same value share an owner.
+// Inside the session's static_scope the slot is a private global instead, so it outlives the call.
+// Anything that keeps the value (a store or return) takes a copy of it, see copy_stored_value.
+llvm::Value* create_temporary(llvm::Type* type, const std::string& name = "", llvm::Value* owner = nullptr);
+
+// The NUL terminated characters of text: a private constant, one per distinct text in the module
+llvm::GlobalVariable* string_literal(const std::string& text);
+
+// Fill slot, an aggregate_type (array or struct) literal, with values. When they are all compile-time
+// constants this is one memcpy from a private constant global; returns false, storing nothing, otherwise.
+bool copy_constant_literal(llvm::Value* slot, llvm::Type* aggregate_type, const std::vector<llvm::Value*>& values);
+
+// End the lifetime of a temporary once a consumer that does not keep it is done with it
+void release_temporary(const StoredValue& v);
+
+// Forget pending temporaries when a function's body is finished
+void clear_temporaries();
 
 #endif // TYPES_HPP